@@ -0,0 +1,271 @@
+#ifndef ARCLENGTH_H
+#define ARCLENGTH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Arc length index of a curve: a monotone table of (u, s) nodes with the speed |C'(u)| at every node.
+// The parameter domain is split into spans (the knot spans of a B-spline), every span into a fixed
+// number of sub-intervals integrated with 5 point Gauss-Legendre. Lengths are stored relative to the
+// span start, so moving a control point only re-integrates the spans it influences.
+//
+// Curve is any class with EvaluateDerivatives(const vector<float>& us, int k, vector<glm::vec3>& ders).
+class ArcLengthTable
+{
+public:
+    ArcLengthTable() = default;
+
+    // index the curve over the spans [breaks[i], breaks[i + 1]], each split into subdivisions pieces
+    template <class Curve>
+    void build(const Curve& curve, const vector<float>& breaks, const int subdivisions)
+    {
+        m_breaks = breaks;
+        m_subdivisions = max(subdivisions, 1);
+        const int spans = m_breaks.size() - 1;
+        const int nodes = spans * m_subdivisions + 1;
+        m_u.resize(nodes);
+        m_local.resize(nodes);
+        m_speed.resize(nodes);
+        m_spanStart.assign(spans + 1, 0.0f);
+        m_spanLength.assign(spans, 0.0f);
+        m_dirty.assign(spans, 1);
+        for (int span = 0; span < spans; span++)
+        {
+            const float u0 = m_breaks[span], u1 = m_breaks[span + 1];
+            for (int j = 0; j < m_subdivisions; j++)
+                m_u[span * m_subdivisions + j] = u0 + (u1 - u0) * (float)j / (float)m_subdivisions;
+        }
+        m_u[nodes - 1] = m_breaks.back();
+        m_anyDirty = true;
+        update(curve);
+    }
+
+    bool empty() const
+    {
+        return m_breaks.size() < 2;
+    }
+
+    // mark the spans overlapping (u0, u1) for re-integration
+    void invalidate(const float u0, const float u1)
+    {
+        for (int span = 0; span + 1 < (int)m_breaks.size(); span++)
+        {
+            if (m_breaks[span] < u1 && m_breaks[span + 1] > u0)
+            {
+                m_dirty[span] = 1;
+                m_anyDirty = true;
+            }
+        }
+    }
+
+    bool dirty() const
+    {
+        return m_anyDirty;
+    }
+
+    // re-integrate the dirty spans and refresh the span offsets
+    template <class Curve>
+    void update(const Curve& curve)
+    {
+        if (!m_anyDirty)
+            return;
+
+        // gather Gauss points and node parameters of all dirty spans into one batch
+        vector<float> us;
+        for (int span = 0; span + 1 < (int)m_breaks.size(); span++)
+        {
+            if (!m_dirty[span])
+                continue;
+            for (int j = 0; j < m_subdivisions; j++)
+            {
+                const int node = span * m_subdivisions + j;
+                appendGaussPoints(m_u[node], m_u[node + 1], us);
+            }
+            for (int j = 0; j <= m_subdivisions; j++)
+                us.push_back(m_u[span * m_subdivisions + j]);
+        }
+        vector<glm::vec3> ders;
+        curve.EvaluateDerivatives(us, 1, ders);
+
+        int index = 0;
+        for (int span = 0; span + 1 < (int)m_breaks.size(); span++)
+        {
+            if (!m_dirty[span])
+                continue;
+            const int first = span * m_subdivisions;
+            float local = 0.0f;
+            for (int j = 0; j < m_subdivisions; j++)
+            {
+                m_local[first + j] = local;
+                const float half = 0.5f * (m_u[first + j + 1] - m_u[first + j]);
+                float length = 0.0f;
+                for (int g = 0; g < 5; g++, index++)
+                    length += gaussWeights()[g] * glm::length(ders[2 * index + 1]);
+                local += half * length;
+            }
+            for (int j = 0; j <= m_subdivisions; j++, index++)
+                m_speed[first + j] = glm::length(ders[2 * index + 1]);
+            m_spanLength[span] = local;
+            m_dirty[span] = 0;
+        }
+
+        // prefix sum over the span lengths only, O(spans)
+        for (int span = 0; span + 1 < (int)m_breaks.size(); span++)
+            m_spanStart[span + 1] = m_spanStart[span] + m_spanLength[span];
+        m_local.back() = 0.0f;
+        m_anyDirty = false;
+    }
+
+    // total arc length
+    float length() const
+    {
+        return m_spanStart.empty() ? 0.0f : m_spanStart.back();
+    }
+
+    // arc length from the domain start to the table node
+    float nodeLength(const int node) const
+    {
+        const int span = node / m_subdivisions;
+        return m_spanStart[span] + m_local[node];
+    }
+
+    /**
+     * @brief      Parameters of count + 1 points equally spaced in arc length, ends included
+     * @param[in]  curve        The indexed curve, used for the Newton polish
+     * @param[in]  count        Number of intervals
+     * @param[out] us           Parameters
+     * @param[in]  newtonSteps  Newton iterations on s(u) = target after the table interpolation
+     * @note       Targets are monotone so the table is walked with a cursor, O(1) amortised per sample
+     */
+    template <class Curve>
+    void equalSpacing(const Curve& curve, const int count, vector<float>& us, const int newtonSteps = 1) const
+    {
+        us.resize(count + 1);
+        vector<int> nodes(count + 1);
+        const float total = length();
+        int node = 0;
+        const int last = m_u.size() - 1;
+        for (int i = 0; i <= count; i++)
+        {
+            const float s = total * (float)i / (float)count;
+            while (node < last - 1 && nodeLength(node + 1) <= s)
+                node++;
+            nodes[i] = node;
+            us[i] = interpolate(node, s);
+        }
+        us[0] = m_u.front();
+        us[count] = m_u.back();
+
+        for (int step = 0; step < newtonSteps; step++)
+            polish(curve, nodes, total / (float)max(count, 1), us);
+    }
+
+    // parameter at arc length s, random access through binary search
+    template <class Curve>
+    float parameter(const Curve& curve, const float s, const int newtonSteps = 1) const
+    {
+        int lo = 0, hi = m_u.size() - 1;
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+            if (nodeLength(mid) <= s)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        vector<float> us(1, interpolate(lo, s));
+        vector<int> nodes(1, lo);
+        for (int step = 0; step < newtonSteps; step++)
+            polishTargets(curve, nodes, &s, us);
+        return us[0];
+    }
+
+private:
+    vector<float> m_breaks; // span boundaries
+    int m_subdivisions = 1; // sub-intervals per span
+    vector<float> m_u; // node parameters
+    vector<float> m_local; // arc length of the node from the start of its span (the last node starts an empty span)
+    vector<float> m_speed; // |C'(u)| at the node
+    vector<float> m_spanStart; // arc length at the span starts, last entry is the total
+    vector<char> m_dirty;
+    vector<float> m_spanLength;
+    bool m_anyDirty = false;
+
+    static const float* gaussNodes()
+    {
+        static const float nodes[5] = {-0.9061798459f, -0.5384693101f, 0.0f, 0.5384693101f, 0.9061798459f};
+        return nodes;
+    }
+
+    static const float* gaussWeights()
+    {
+        static const float weights[5] = {0.2369268851f, 0.4786286705f, 0.5688888889f, 0.4786286705f, 0.2369268851f};
+        return weights;
+    }
+
+    static void appendGaussPoints(const float a, const float b, vector<float>& us)
+    {
+        const float mid = 0.5f * (a + b), half = 0.5f * (b - a);
+        for (int g = 0; g < 5; g++)
+            us.push_back(mid + half * gaussNodes()[g]);
+    }
+
+    // cubic Hermite interpolation of u(s) between node and node + 1, du/ds = 1 / speed at the ends
+    float interpolate(const int node, const float s) const
+    {
+        const float s0 = nodeLength(node), s1 = nodeLength(node + 1);
+        const float u0 = m_u[node], u1 = m_u[node + 1];
+        const float h = s1 - s0;
+        if (h <= 0.0f)
+            return u0;
+        const float t = min(max((s - s0) / h, 0.0f), 1.0f);
+        if (m_speed[node] <= 0.0f || m_speed[node + 1] <= 0.0f)
+            return u0 + (u1 - u0) * t;
+
+        const float t2 = t * t, t3 = t2 * t;
+        const float u = (2.0f * t3 - 3.0f * t2 + 1.0f) * u0 + (t3 - 2.0f * t2 + t) * h / m_speed[node] +
+                        (-2.0f * t3 + 3.0f * t2) * u1 + (t3 - t2) * h / m_speed[node + 1];
+        return min(max(u, u0), u1);
+    }
+
+    template <class Curve>
+    void polish(const Curve& curve, const vector<int>& nodes, const float spacing, vector<float>& us) const
+    {
+        vector<float> targets(us.size());
+        for (int i = 0; i < (int)us.size(); i++)
+            targets[i] = spacing * (float)i;
+        polishTargets(curve, nodes, &targets[0], us);
+    }
+
+    // one Newton step on s(u) - target = 0 for every sample, all integrals in one derivative batch
+    template <class Curve>
+    void polishTargets(const Curve& curve, const vector<int>& nodes, const float* targets, vector<float>& us) const
+    {
+        vector<float> points;
+        points.reserve(us.size() * 6);
+        for (int i = 0; i < (int)us.size(); i++)
+        {
+            appendGaussPoints(m_u[nodes[i]], us[i], points);
+            points.push_back(us[i]);
+        }
+        vector<glm::vec3> ders;
+        curve.EvaluateDerivatives(points, 1, ders);
+
+        for (int i = 0; i < (int)us.size(); i++)
+        {
+            const int node = nodes[i];
+            const float half = 0.5f * (us[i] - m_u[node]);
+            float length = 0.0f;
+            for (int g = 0; g < 5; g++)
+                length += gaussWeights()[g] * glm::length(ders[2 * (6 * i + g) + 1]);
+            const float s = nodeLength(node) + half * length;
+            const float speed = glm::length(ders[2 * (6 * i + 5) + 1]);
+            if (speed > 0.0f)
+                us[i] = min(max(us[i] - (s - targets[i]) / speed, m_u[node]), m_u[node + 1]);
+        }
+    }
+};
+#endif
@@ -1,42 +1,208 @@
 #ifndef BASIS_H
 #define BASIS_H
 
+// define BSPLINE_NO_GL to use the curves for evaluation only (no OpenGL headers, buffers or draw calls)
+#ifndef BSPLINE_NO_GL
 #include <glad/glad.h> // holds all OpenGL type declarations
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "packed.h"
+#include "profiler.h"
+#ifndef BSPLINE_NO_GL
 #include "shader.h"
+#endif
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
 
+// what happens to the CPU copy of the draw vertices once it has been uploaded
+enum class VertexResidency
+{
+    Keep, // keep m_vertices (default)
+    Discard, // free it, RestoreVertices() tessellates again
+    Compressed // keep it quantized to 16 bits per coordinate, RestoreVertices() unpacks it
+};
+
+// encoding of the draw vertices in the vertex buffer, dequantized in colors.vs
+enum class VertexFormat
+{
+    Float, // glm::vec3, 12 bytes
+    Unorm16, // 16-bit normalized over the bounding box, 6 bytes
+    Unorm8 // 8-bit normalized over the bounding box, 3 bytes
+};
+
 class BasisCurve
 {
 public:
     // default constructor
     BasisCurve() = default;
 
-    // constructor
-    BasisCurve(const vector<glm::vec3>& controlPoints, const int count = 100)
-        : m_controlPoints(controlPoints), m_count(count)
+    // constructor, pass the control points as an rvalue to move them in instead of copying
+    BasisCurve(vector<glm::vec3> controlPoints, const int count = 100)
+        : m_controlPoints(move(controlPoints)), m_count(count)
     {
     }
 
+    virtual ~BasisCurve() = default;
+
+    // the virtual destructor would suppress the implicit moves
+    BasisCurve(const BasisCurve&) = default;
+    BasisCurve(BasisCurve&&) = default;
+    BasisCurve& operator=(const BasisCurve&) = default;
+    BasisCurve& operator=(BasisCurve&&) = default;
+
+    // regenerate draw vertices from the control points, no GL calls involved
+    void Tessellate()
+    {
+        PROFILE_CPU_SCOPE("Tessellate");
+        m_vertices.clear();
+        m_packedVertices.clear();
+        createDrawVertices();
+        m_vertexCount = m_vertices.size();
+    }
+
+    const vector<glm::vec3>& GetControlPoints() const
+    {
+        return m_controlPoints;
+    }
+
+    // the CPU copy of the draw vertices, empty after ReleaseVertices() until RestoreVertices()
+    const vector<glm::vec3>& GetVertices() const
+    {
+        return m_vertices;
+    }
+
+    // number of draw vertices, also while the CPU copy is released
+    int GetVertexCount() const
+    {
+        return m_vertexCount;
+    }
+
+    /**
+     * @brief      Set what happens to the CPU copy of the draw vertices after upload
+     * @note       Discard and Compressed leave only the GPU buffer with the exact vertices. Vertex data is
+     *             regenerated every Tessellate(), so editing a curve allocates its vertices again
+     */
+    void SetVertexResidency(const VertexResidency residency)
+    {
+        m_residency = residency;
+    }
+
+    VertexResidency GetVertexResidency() const
+    {
+        return m_residency;
+    }
+
+    /**
+     * @brief      Set the precision budget of the uploaded vertices
+     * @param[in]  maxError  Largest error allowed per coordinate, in curve units. The smallest format
+     *                       within it is chosen at every upload from the bounding box of the vertices;
+     *                       0 (the default) always uploads floats
+     */
+    void SetVertexPrecision(const float maxError)
+    {
+        m_vertexPrecision = max(maxError, 0.0f);
+    }
+
+    // format of the last upload
+    VertexFormat GetVertexFormat() const
+    {
+        return m_vertexFormat;
+    }
+
+    // smallest format whose quantization error over the bounding box of the current vertices stays within
+    // the precision budget, what the next upload uses
+    VertexFormat SelectVertexFormat() const
+    {
+        if (m_vertexPrecision <= 0.0f || m_vertices.empty())
+            return VertexFormat::Float;
+        glm::vec3 lo = m_vertices[0], hi = m_vertices[0];
+        for (const glm::vec3& v : m_vertices)
+        {
+            lo = glm::min(lo, v);
+            hi = glm::max(hi, v);
+        }
+        if (PackedVerticesT<uint8_t>::error(hi - lo) <= m_vertexPrecision)
+            return VertexFormat::Unorm8;
+        if (PackedVertices::error(hi - lo) <= m_vertexPrecision)
+            return VertexFormat::Unorm16;
+        return VertexFormat::Float;
+    }
+
+    // apply the residency policy to the CPU copy, called after every vertex upload
+    void ReleaseVertices()
+    {
+        if (m_residency == VertexResidency::Keep || m_vertices.size() != (size_t)m_vertexCount)
+            return;
+        if (m_residency == VertexResidency::Compressed && m_packedVertices.size() != m_vertices.size())
+            m_packedVertices.pack(m_vertices);
+        m_vertices.clear();
+        m_vertices.shrink_to_fit();
+    }
+
+    // bring the CPU copy back after ReleaseVertices(), compressed vertices come back quantized
+    const vector<glm::vec3>& RestoreVertices()
+    {
+        if (m_vertices.size() == (size_t)m_vertexCount)
+            return m_vertices;
+        if (m_packedVertices.size() == (size_t)m_vertexCount)
+            m_packedVertices.unpack(m_vertices);
+        else
+            Tessellate();
+        return m_vertices;
+    }
+
+    // curvature from the first two derivatives, |C' x C''| / |C'|^3
+    static float Curvature(const glm::vec3& d1, const glm::vec3& d2)
+    {
+        float speed = glm::length(d1);
+        return speed > 0.0f ? glm::length(glm::cross(d1, d2)) / (speed * speed * speed) : 0.0f;
+    }
+
+    // derivatives 0..k of the projected curve C = A / w from the derivatives (A, w) of the homogeneous curve
+    template <typename T>
+    static void rationalDerivatives(const glm::vec<4, T>* Aders, const int k, glm::vec<3, T>* ders)
+    {
+        for (int j = 0; j <= k; j++)
+        {
+            glm::vec<3, T> v = glm::vec<3, T>(Aders[j]);
+            T binomial = T(1);
+            for (int i = 1; i <= j; i++)
+            {
+                binomial = binomial * (T)(j - i + 1) / (T)i;
+                v -= binomial * Aders[i].w * ders[j - i];
+            }
+            ders[j] = v / Aders[0].w;
+        }
+    }
+
+    // move control point id by dir and regenerate the draw vertices
+    void MoveControlPoint(const unsigned int id, const glm::vec3 dir)
+    {
+        m_controlPoints[id] += dir;
+        onControlPointMoved(id);
+        Tessellate();
+    }
+
+#ifndef BSPLINE_NO_GL
     // initial method
     virtual void init()
     {
-        createDrawVertices();
+        Tessellate();
         initDrawConfig();
     }
 
     // update draggindId control points
     void Update(const unsigned int draggingId, const glm::vec3 dir)
     {
-        m_controlPoints[draggingId] += dir;
-        m_vertices.clear();
-        createDrawVertices();
+        MoveControlPoint(draggingId, dir);
+
+        PROFILE_GPU_SCOPE("Upload");
         //glBindVertexArray(VAO_controlPoints);
         glBindBuffer(GL_ARRAY_BUFFER, VBO_controlPoints);
 
@@ -45,13 +211,19 @@ public:
         //glBindBuffer(GL_ARRAY_BUFFER, 0);
         //glBindVertexArray(0);
 
-        //glBindVertexArray(VAO_vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices);
-
-        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(glm::vec3), &m_vertices[0], GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploadVertices();
+    }
 
+    // re-upload control points and vertices, needed when their count changed (e.g. after knot insertion)
+    void Upload()
+    {
+        RestoreVertices();
+        PROFILE_GPU_SCOPE("Upload");
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_controlPoints);
+        glBufferData(GL_ARRAY_BUFFER, m_controlPoints.size() * sizeof(glm::vec3), &m_controlPoints[0], GL_STREAM_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        //glBindVertexArray(0);
+        uploadVertices();
     }
 
     // draw curve
@@ -63,6 +235,9 @@ public:
 
     void DrawControlPoints(Shader& shader)
     {
+        PROFILE_CPU_SCOPE("DrawControlPoints");
+        shader.setVec3("origin", glm::vec3(0.0f));
+        shader.setVec3("extent", glm::vec3(1.0f));
         glBindVertexArray(VAO_controlPoints);
         //glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices);
         glDrawArrays(GL_POINTS, 0, m_controlPoints.size());
@@ -71,20 +246,38 @@ public:
 
     void DrawVertices(Shader& shader)
     {
+        PROFILE_CPU_SCOPE("DrawVertices");
+        shader.setVec3("origin", m_vertexOrigin);
+        shader.setVec3("extent", m_vertexExtent);
         glBindVertexArray(VAO_vertices);
-        glDrawArrays(GL_LINE_STRIP, 0, m_vertices.size());
+        glDrawArrays(GL_LINE_STRIP, 0, m_vertexCount);
         glBindVertexArray(0);
     }
+#endif
 
 protected:
     vector<glm::vec3> m_controlPoints;
     vector<glm::vec3> m_vertices;
+    int m_vertexCount = 0; // size of m_vertices as tessellated, kept while the CPU copy is released
+    VertexResidency m_residency = VertexResidency::Keep;
+    PackedVertices m_packedVertices; // CPU copy under VertexResidency::Compressed
+    float m_vertexPrecision = 0.0f; // error budget of the uploaded vertices, 0 for floats
+    VertexFormat m_vertexFormat = VertexFormat::Float;
+    glm::vec3 m_vertexOrigin = glm::vec3(0.0f), m_vertexExtent = glm::vec3(1.0f); // dequantization in colors.vs
     unsigned int VAO_controlPoints, VBO_controlPoints, VAO_vertices, VBO_vertices;
     int m_count;
 
+    // lets subclasses drop data derived from the control points
+    virtual void onControlPointMoved(const unsigned int /*id*/)
+    {
+    }
+
+#ifndef BSPLINE_NO_GL
+
     // initialize vertex buffers and vertex arrays
     void initDrawConfig()
     {
+        PROFILE_CPU_SCOPE("Upload");
         // Part1: initialize control points
         // create buffers/arrays
         glGenVertexArrays(1, &VAO_controlPoints);
@@ -108,24 +301,56 @@ protected:
         // create buffers/arrays
         glGenVertexArrays(1, &VAO_vertices);
         glGenBuffers(1, &VBO_vertices);
+        uploadVertices();
+    }
+
+    // load m_vertices into VBO_vertices in the smallest format within the precision budget
+    void uploadVertices()
+    {
+        m_vertexFormat = SelectVertexFormat();
 
         glBindVertexArray(VAO_vertices);
-        // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices);
-        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(glm::vec3), &m_vertices[0], GL_STREAM_DRAW);
-
-        //  set the vertex attribute pointers
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        if (m_vertexFormat == VertexFormat::Unorm16)
+        {
+            // same encoding as the compressed CPU copy, which keeps it
+            m_packedVertices.pack(m_vertices);
+            glBufferData(GL_ARRAY_BUFFER, m_packedVertices.size() * sizeof(m_packedVertices.values[0]), m_packedVertices.values.data(), GL_STREAM_DRAW);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(m_packedVertices.values[0]), (void*)0);
+            m_vertexOrigin = m_packedVertices.origin;
+            m_vertexExtent = m_packedVertices.extent();
+            if (m_residency != VertexResidency::Compressed)
+                m_packedVertices.clear();
+        }
+        else if (m_vertexFormat == VertexFormat::Unorm8)
+        {
+            PackedVerticesT<uint8_t> packed;
+            packed.pack(m_vertices);
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(packed.values[0]), packed.values.data(), GL_STREAM_DRAW);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(packed.values[0]), (void*)0);
+            m_vertexOrigin = packed.origin;
+            m_vertexExtent = packed.extent();
+        }
+        else
+        {
+            glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(glm::vec3), m_vertices.data(), GL_STREAM_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            m_vertexOrigin = glm::vec3(0.0f);
+            m_vertexExtent = glm::vec3(1.0f);
+        }
         glEnableVertexAttribArray(0);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
+        ReleaseVertices();
     }
+#endif
 
 private:
     // create draw vertices according to control points and parameter domain
     virtual void createDrawVertices()
     {
+        m_vertices.reserve((m_controlPoints.size() - 1) * (m_count / (m_controlPoints.size() - 1) + 1));
         for (int i = 0; i < m_controlPoints.size() - 1; i++)
         {
             for (int j = 0; j <= m_count / (m_controlPoints.size()-1); j++)
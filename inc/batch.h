@@ -0,0 +1,153 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "bspline.h"
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Many non-rational B-spline curves with one knots array and degree, evaluated on one parameter grid.
+//
+// The basis of the grid is evaluated once: a span and p + 1 values per sample, the rows of the banded
+// matrix B (samples x control points). The control points are kept in SoA blocks of `width` curves,
+// coordinate axis of control point i of all curves in a block side by side, so the vertices are the
+// product B P with the curves of a block as the inner dimension. Every block reads its control points
+// (a few KB) from cache and streams its vertices out; no knot search or basis work per curve.
+class BsplineBatch
+{
+public:
+    static const int width = 8; // curves per block
+
+    /**
+     * @brief      Batch constructor
+     * @param[in]  knots  Knots array shared by all curves, defines the number of control points
+     * @param[in]  p      Degree
+     */
+    BsplineBatch(const vector<float>& knots, const int p)
+        : m_tables(KnotTables::intern(knots, p)), m_p(p), m_n(knots.size() - p - 1)
+    {
+    }
+
+    // number of curves
+    int size() const
+    {
+        return m_size;
+    }
+
+    // number of parameters in the grid
+    int samples() const
+    {
+        return m_spans.size();
+    }
+
+    void clear()
+    {
+        m_size = 0;
+        m_points.clear();
+    }
+
+    // add a curve with the shared knots, returns its index, or -1 if controlPoints.size() does not match
+    // the knots
+    int add(const vector<glm::vec3>& controlPoints)
+    {
+        if ((int)controlPoints.size() != m_n)
+            return -1;
+        if (m_size % width == 0)
+            m_points.resize(m_points.size() + m_n * 3 * width, 0.0f);
+        const int curve = m_size++;
+        for (int i = 0; i < m_n; i++)
+            setControlPoint(curve, i, controlPoints[i]);
+        return curve;
+    }
+
+    void setControlPoint(const int curve, const int i, const glm::vec3& P)
+    {
+        float* block = &m_points[(curve / width) * m_n * 3 * width];
+        for (int axis = 0; axis < 3; axis++)
+            block[(i * 3 + axis) * width + curve % width] = P[axis];
+    }
+
+    // parameter grid shared by all curves, its basis is evaluated here once
+    void setParameters(const vector<float>& us)
+    {
+        const int order = m_p + 1;
+        m_spans.resize(us.size());
+        m_basis.resize(us.size() * order);
+        BsplineCurve::DerivativeWorkspace workspace;
+        for (int s = 0; s < (int)us.size(); s++)
+        {
+            m_spans[s] = BsplineCurve::evaluateBasis(m_tables->knots.data(), m_n - 1, m_p, us[s], 0, workspace);
+            copy(workspace.basisDers.begin(), workspace.basisDers.begin() + order, m_basis.begin() + s * order);
+        }
+    }
+
+    // count + 1 parameters equally spaced over the knot domain
+    void setUniformParameters(const int count)
+    {
+        const vector<float>& knots = m_tables->knots;
+        const float u0 = knots[m_p], u1 = knots[m_n];
+        const float delta = (u1 - u0) / (float)count;
+        vector<float> us(count + 1);
+        for (int i = 0; i < count; i++)
+            us[i] = u0 + (float)i * delta;
+        us[count] = u1;
+        setParameters(us);
+    }
+
+    /**
+     * @brief      Positions of all curves on the grid
+     * @param[out] vertices  In blocks like the control points: axis of sample s of curve c at
+     *                       vertices[((c / width * samples() + s) * 3 + axis) * width + c % width]
+     */
+    void evaluate(vector<float>& vertices) const
+    {
+        const int order = m_p + 1;
+        const int blocks = (m_size + width - 1) / width;
+        const int samples = m_spans.size();
+        vertices.resize(blocks * samples * 3 * width);
+        for (int b = 0; b < blocks; b++)
+        {
+            const float* block = &m_points[b * m_n * 3 * width];
+            float* out = &vertices[b * samples * 3 * width];
+            for (int s = 0; s < samples; s++, out += 3 * width)
+            {
+                const float* N = &m_basis[s * order];
+                const float* P = block + (m_spans[s] - m_p) * 3 * width;
+                for (int j = 0; j < 3 * width; j++)
+                    out[j] = 0.0f;
+                for (int r = 0; r <= m_p; r++, P += 3 * width)
+                {
+                    for (int j = 0; j < 3 * width; j++)
+                        out[j] += N[r] * P[j];
+                }
+            }
+        }
+    }
+
+    // vertices of one curve out of the evaluate() output
+    void curveVertices(const vector<float>& vertices, const int curve, vector<glm::vec3>& out) const
+    {
+        const int samples = m_spans.size();
+        const float* block = &vertices[(curve / width) * samples * 3 * width];
+        const int lane = curve % width;
+        out.resize(samples);
+        for (int s = 0; s < samples; s++)
+        {
+            const float* v = block + s * 3 * width + lane;
+            out[s] = glm::vec3(v[0], v[width], v[2 * width]);
+        }
+    }
+
+private:
+    shared_ptr<const KnotTables> m_tables; // knots array
+    int m_p;
+    int m_n; // control points per curve
+    int m_size = 0;
+    vector<float> m_points; // m_points[((block * m_n + i) * 3 + axis) * width + lane]
+
+    // basis of the grid: span of sample s and its p + 1 nonzero basis values at m_basis[s * (p + 1)]
+    vector<int> m_spans;
+    vector<float> m_basis;
+};
+#endif
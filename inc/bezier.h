@@ -1,7 +1,10 @@
 #ifndef BEZIER_H
 #define BEZIER_H
 
+#include "arclength.h"
 #include "basis.h"
+#include "intersection.h"
+#include "projection.h"
 using namespace std;
 
 class BezierCurve : public BasisCurve
@@ -11,71 +14,229 @@ public:
     BezierCurve() = default;
 
     // basis bezier curve constructor
-    BezierCurve(const vector<glm::vec3>& controlPoints, const int count = 100)
-        : BasisCurve(controlPoints, count), m_isRational(false)
+    BezierCurve(vector<glm::vec3> controlPoints, const int count = 100)
+        : BasisCurve(move(controlPoints), count), m_isRational(false)
     {
+        initHomogeneousPoints({});
 	}
 
     // rational bezier curve constructor
-    BezierCurve(const vector<glm::vec3>& controlPoints, const vector<float>& weights, const int count = 100)
-        : BasisCurve(controlPoints, count), m_weights(weights), m_isRational(true)
+    BezierCurve(vector<glm::vec3> controlPoints, const vector<float>& weights, const int count = 100)
+        : BasisCurve(move(controlPoints), count), m_isRational(true)
 	{
+        initHomogeneousPoints(weights);
 	}
 
+    /**
+     * @brief      Evaluate positions and derivatives for a batch of parameters
+     * @param[in]  us    Parameters in [0, 1], float or double; the evaluation runs in the same type
+     * @param[in]  k     Highest derivative order
+     * @param[out] ders  ders[i * (k + 1) + j] is the j-th derivative at us[i], j = 0 is the position
+     * @note       The j-th derivative is the degree n - j Bezier curve over the j-th forward differences
+     *             (hodograph); rational curves use the quotient rule on the homogeneous derivatives
+     */
+    template <typename T>
+    void EvaluateDerivatives(const vector<T>& us, const int k, vector<glm::vec<3, T>>& ders) const
+    {
+        const int size = m_controlPoints.size();
+        const int n = size - 1;
+        const int du = min(k, n);
+        ders.assign(us.size() * (k + 1), glm::vec<3, T>(0));
+
+        // hodograph control points of every order, level j starts at offsets[j] and holds n - j + 1 points
+        vector<int> offsets(du + 2, 0);
+        for (int j = 0; j <= du; j++)
+            offsets[j + 1] = offsets[j] + n - j + 1;
+        vector<glm::vec<4, T>> hodographs(offsets[du + 1]);
+        for (int i = 0; i < size; i++)
+            hodographs[i] = glm::vec<4, T>(m_Pw[i]);
+        for (int j = 1; j <= du; j++)
+        {
+            for (int i = 0; i <= n - j; i++)
+            {
+                hodographs[offsets[j] + i] =
+                    (T)(n - j + 1) * (hodographs[offsets[j - 1] + i + 1] - hodographs[offsets[j - 1] + i]);
+            }
+        }
+
+        vector<glm::vec<4, T>> temp(size);
+        vector<glm::vec<4, T>> Aders(k + 1);
+        for (int s = 0; s < (int)us.size(); s++)
+        {
+            const T u = us[s];
+            fill(Aders.begin(), Aders.end(), glm::vec<4, T>(0));
+            for (int j = 0; j <= du; j++)
+            {
+                // de Casteljau on level j
+                const int count = n - j + 1;
+                copy(hodographs.begin() + offsets[j], hodographs.begin() + offsets[j] + count, temp.begin());
+                for (int r = 1; r < count; r++)
+                    for (int i = 0; i < count - r; i++)
+                        temp[i] = (T(1) - u) * temp[i] + u * temp[i + 1];
+                Aders[j] = temp[0];
+            }
+
+            glm::vec<3, T>* out = &ders[s * (k + 1)];
+            if (m_isRational)
+            {
+                rationalDerivatives(&Aders[0], k, out);
+            }
+            else
+            {
+                for (int j = 0; j <= k; j++)
+                    out[j] = glm::vec<3, T>(Aders[j]);
+            }
+        }
+    }
+
+    // arc length index over [0, 1], built on first use and rebuilt after a control point moved
+    const ArcLengthTable& GetArcLength() const
+    {
+        if (!m_arcLengthValid)
+        {
+            m_arcLength.build(*this, vector<float>{0.0f, 1.0f}, max(8, 2 * (int)m_controlPoints.size()));
+            m_arcLengthValid = true;
+        }
+        return m_arcLength;
+    }
+
+    // parameters of count + 1 points equally spaced in arc length
+    void SampleByArcLength(const int count, vector<float>& us) const
+    {
+        GetArcLength().equalSpacing(*this, count, us);
+    }
+
+    // the curve as a single segment over the clamped knots [0, .., 0, 1, .., 1], cached
+    const BezierSegments& GetBezierSegments() const
+    {
+        if (!m_segmentsValid)
+        {
+            const int size = m_controlPoints.size();
+            vector<float> knots(2 * size, 0.0f);
+            fill(knots.begin() + size, knots.end(), 1.0f);
+            m_segments.build(m_Pw, knots, size - 1);
+            m_segmentsValid = true;
+        }
+        return m_segments;
+    }
+
+    // closest point on the curve to x
+    CurveProjector::Result Project(const glm::vec3& x) const
+    {
+        return getProjector().project(x);
+    }
+
+    /**
+     * @brief      Closest points for many query points
+     * @param[in]  points   Query points
+     * @param[out] results  One result per query point
+     * @param[in]  threads  Worker threads, 0 for the hardware concurrency
+     */
+    void ProjectBatch(const vector<glm::vec3>& points, vector<CurveProjector::Result>& results, const int threads = 0) const
+    {
+        getProjector().projectBatch(points, results, threads);
+    }
+
+    /**
+     * @brief      Intersections with another curve (BsplineCurve or BezierCurve)
+     * @param[in]  other      The other curve
+     * @param[in]  tolerance  Distance below which the curves count as intersecting
+     * @param[out] out        Intersections, u0 on this curve and u1 on the other
+     */
+    template <class Curve>
+    void Intersect(const Curve& other, const float tolerance, vector<CurveIntersection>& out) const
+    {
+        out.clear();
+        CurveIntersector().intersect(GetBezierSegments(), other.GetBezierSegments(), tolerance, out);
+    }
+
+    // intersections with the ray origin + t * direction, t >= 0
+    void IntersectRay(const glm::vec3& origin, const glm::vec3& direction, const float tolerance, vector<RayIntersection>& out) const
+    {
+        out.clear();
+        CurveIntersector().intersectRay(GetBezierSegments(), origin, direction, tolerance, out);
+    }
+
 protected:
-    vector<float> m_weights; // weights of control points
     bool m_isRational; // rational bezier curve or not
+    // homogeneous control points (w * P, w) and the only copy of the weights, as in BsplineCurve;
+    // m_controlPoints is the Cartesian copy for editing and drawing the control polygon
+    vector<glm::vec4> m_Pw;
+
+    // homogeneous control points from m_controlPoints and weights, all 1 when empty
+    void initHomogeneousPoints(const vector<float>& weights)
+    {
+        m_Pw.resize(m_controlPoints.size());
+        for (int i = 0; i < (int)m_Pw.size(); i++)
+        {
+            const float w = weights.empty() ? 1.0f : weights[i];
+            m_Pw[i] = glm::vec4(m_controlPoints[i] * w, w);
+        }
+    }
+
+    void updateHomogeneousPoint(const int i)
+    {
+        const float w = m_Pw[i].w;
+        m_Pw[i] = glm::vec4(m_controlPoints[i] * w, w);
+    }
 
 private:
+    mutable ArcLengthTable m_arcLength; // cached arc length index
+    mutable bool m_arcLengthValid = false;
+
+    mutable BezierSegments m_segments; // the curve as a single segment
+    mutable bool m_segmentsValid = false;
+
+    mutable CurveProjector m_projector; // cached closest point hierarchy
+    mutable bool m_projectorValid = false;
+
+    const CurveProjector& getProjector() const
+    {
+        if (!m_projectorValid)
+        {
+            m_projector.build(GetBezierSegments());
+            m_projectorValid = true;
+        }
+        return m_projector;
+    }
+
+    void onControlPointMoved(const unsigned int id) override
+    {
+        updateHomogeneousPoint(id);
+        m_arcLengthValid = false;
+        m_segmentsValid = false;
+        m_projectorValid = false;
+    }
+
+    // de Casteljau scratch buffer, reused between samples
+    vector<glm::vec4> m_temp;
+
     // create draw vertices according to control points and parameter domain
     void createDrawVertices() override
     {
-        float u = 0;
-        float delta = 1.0f / (float)m_count;
+        m_temp.resize(m_controlPoints.size());
+        m_vertices.reserve(m_count + 1);
+
+        // not accumulated, no drift over many samples; the last sample is the end point exactly
+        const float delta = 1.0f / (float)m_count;
         for (int i = 0; i <= m_count; i++)
-        {
-            createVertexByU(u);
-            u += delta;
-        }
+            createVertexByU(i == m_count ? 1.0f : (float)i * delta);
     }
 
     // create vertex by parameter u
     void createVertexByU(const float u)
     {
+        // de Casteljau on the homogeneous points, the same 4-wide blend for both cases
         const int size = m_controlPoints.size();
-        vector<glm::vec3> temp;
-        if (!m_isRational) // non-rational condition
-        {
-            for (int i = 0; i < size; i++)
+        glm::vec4* temp = m_temp.data();
+        copy(m_Pw.begin(), m_Pw.end(), temp);
+        for (int i = 0; i < size; i++)
+            for (int j = 0; j < size - i - 1; j++)
             {
-                temp.push_back(m_controlPoints[i]);
+                temp[j] = (1.0f - u) * temp[j] + u * temp[j + 1];
             }
 
-            for (int i = 0; i < size; i++)
-                for (int j = 0; j < size - i - 1; j++)
-                {
-                    temp[j] = (1.0f - u) * temp[j] + u * temp[j + 1];
-                }
-        }
-		else // rational condition
-		{
-            vector<float> weights(m_weights);
-			for (int i = 0; i < size; i++)
-			{
-				temp.push_back(m_controlPoints[i] * m_weights[i]);
-			}
-
-            for (int i = 0; i < size; i++)
-                for (int j = 0; j < size - i - 1; j++)
-                {
-                    temp[j] = (1.0f - u) * temp[j] + u * temp[j + 1];
-                    weights[j] = (1.0f - u) * weights[j] + u * weights[j + 1];
-                }
-
-            temp[0] /= weights[0];
-		}
-
-        m_vertices.push_back(temp[0]);
+        m_vertices.push_back(m_isRational ? glm::vec3(temp[0]) / temp[0].w : glm::vec3(temp[0]));
     }
 };
 #endif
\ No newline at end of file
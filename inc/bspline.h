@@ -1,7 +1,15 @@
 #ifndef BSPLINE_H
 #define BSPLINE_H
 
+#include "arclength.h"
 #include "basis.h"
+#include "intersection.h"
+#include "knots.h"
+#include "projection.h"
+#include "segments.h"
+
+#include <algorithm>
+#include <cmath>
 using namespace std;
 
 class BsplineCurve : public BasisCurve
@@ -12,105 +20,898 @@ public:
 
     /**
      * @brief      Parameter constructor
-     * @param[in]  controlPoints  Control points
-     * @param[in]  knots          Knots array
+     * @param[in]  controlPoints  Control points, moved in when passed as an rvalue
+     * @param[in]  knots          Knots array, an rvalue is moved into new shared tables
      * @param[in]  p              Degree(decide curve continuity)
      * @param[in]  count          Number of segments
      */
-    BsplineCurve(const vector<glm::vec3>& controlPoints, const vector<float>& knots, const int p = 3, const int count = 100)
-        : BasisCurve(controlPoints, count), m_p(p), m_knots(knots), m_isRational(false)
+    BsplineCurve(vector<glm::vec3> controlPoints, const vector<float>& knots, const int p = 3, const int count = 100)
+        : BsplineCurve(move(controlPoints), KnotTables::intern(knots, p), count)
     {
     }
 
+    BsplineCurve(vector<glm::vec3> controlPoints, vector<float>&& knots, const int p = 3, const int count = 100)
+        : BsplineCurve(move(controlPoints), KnotTables::intern(move(knots), p), count)
+    {
+    }
+
+    // constructor over shared knot tables, the degree comes with the tables
+    BsplineCurve(vector<glm::vec3> controlPoints, shared_ptr<const KnotTables> tables, const int count = 100)
+        : BasisCurve(move(controlPoints), count), m_p(tables->p), m_tables(move(tables)), m_isRational(false)
+    {
+        initHomogeneousPoints({});
+    }
+
     /**
      * @brief      NURBS parameter constructor
-     * @param[in]  controlPoints  Control points
-     * @param[in]  knots          Knots array
-     * @param[in]  weights        Weights of control points
+     * @param[in]  controlPoints  Control points, moved in when passed as an rvalue
+     * @param[in]  knots          Knots array, an rvalue is moved into new shared tables
+     * @param[in]  weights        Weights of control points, stored in the homogeneous points
      * @param[in]  p              Degree(decide curve continuity)
      * @param[in]  count          Number of segments
      */
-    BsplineCurve(const vector<glm::vec3>& controlPoints,
+    BsplineCurve(vector<glm::vec3> controlPoints,
                  const vector<float>& knots,
                  const vector<float>& weights,
                  const int p = 3, 
                  const int count = 100)
-        : BasisCurve(controlPoints, count), m_knots(knots), m_weights(weights), m_p(p), m_isRational(true)
+        : BsplineCurve(move(controlPoints), KnotTables::intern(knots, p), weights, count)
+    {
+    }
+
+    BsplineCurve(vector<glm::vec3> controlPoints,
+                 vector<float>&& knots,
+                 const vector<float>& weights,
+                 const int p = 3,
+                 const int count = 100)
+        : BsplineCurve(move(controlPoints), KnotTables::intern(move(knots), p), weights, count)
+    {
+    }
+
+    BsplineCurve(vector<glm::vec3> controlPoints, shared_ptr<const KnotTables> tables, const vector<float>& weights, const int count = 100)
+        : BasisCurve(move(controlPoints), count), m_p(tables->p), m_tables(move(tables)), m_isRational(true)
+    {
+        initHomogeneousPoints(weights);
+    }
+
+    /**
+     * @brief      Insert knot u r times without changing the curve shape (Boehm)
+     * @param[in]  u  Parameter of the new knot, inside the domain [knots[p], knots[n + 1]]
+     * @param[in]  r  Number of insertions, clamped so the multiplicity of u does not exceed the degree
+     * @return     Number of knots actually inserted, 0 for u outside the domain
+     * @note       Control point count changes, call Tessellate() and Upload() before drawing again
+     */
+    int InsertKnot(const float u, int r = 1)
+    {
+        const int n = m_controlPoints.size() - 1;
+        if (u < m_tables->knots[m_p] || u > m_tables->knots[n + 1])
+            return 0;
+        // last index of a knot <= u, also for u at the end of an unclamped domain
+        const int k = upper_bound(m_tables->knots.begin(), m_tables->knots.end(), u) - m_tables->knots.begin() - 1;
+        const int s = knotMultiplicity(u);
+        r = min(r, m_p - s);
+        if (r <= 0)
+            return 0;
+
+        vector<glm::vec4> Pw = homogeneousPoints();
+        vector<glm::vec4> Qw(n + r + 1);
+        vector<float> knots(m_tables->knots.size() + r);
+
+        // new knot vector
+        for (int i = 0; i <= k; i++)
+            knots[i] = m_tables->knots[i];
+        for (int i = 1; i <= r; i++)
+            knots[k + i] = u;
+        for (int i = k + 1; i < (int)m_tables->knots.size(); i++)
+            knots[i + r] = m_tables->knots[i];
+
+        // unaffected control points
+        for (int i = 0; i <= k - m_p; i++)
+            Qw[i] = Pw[i];
+        for (int i = k - s; i <= n; i++)
+            Qw[i + r] = Pw[i];
+
+        // only the p - s + 1 points of span k take part in the insertion
+        vector<glm::vec4> Rw(m_p - s + 1);
+        for (int i = 0; i <= m_p - s; i++)
+            Rw[i] = Pw[k - m_p + i];
+
+        int L = k - m_p;
+        for (int j = 1; j <= r; j++)
+        {
+            L = k - m_p + j;
+            for (int i = 0; i <= m_p - j - s; i++)
+            {
+                float alpha = (u - m_tables->knots[L + i]) / (m_tables->knots[i + k + 1] - m_tables->knots[L + i]);
+                Rw[i] = alpha * Rw[i + 1] + (1.0f - alpha) * Rw[i];
+            }
+            Qw[L] = Rw[0];
+            Qw[k + r - j - s] = Rw[m_p - j - s];
+        }
+        for (int i = L + 1; i < k - s; i++)
+            Qw[i] = Rw[i - L];
+
+        m_tables = KnotTables::intern(knots, m_p);
+        setHomogeneousPoints(Qw);
+        m_segmentsValid = false;
+        m_arcLengthValid = false;
+        m_projectorValid = false;
+        return r;
+    }
+
+    /**
+     * @brief      Insert a batch of knots in one pass (knot refinement, Oslo style)
+     * @param[in]  X  Knots to insert, sorted ascending, repeated values allowed, inside the domain
+     *                [knots[p], knots[n + 1]]
+     * @return     false (and the curve unchanged) for unsorted knots or knots outside the domain
+     * @note       Costs O(p) per inserted knot plus one copy of the arrays, instead of one copy per knot
+     */
+    bool RefineKnots(const vector<float>& X)
+    {
+        const int n = m_controlPoints.size() - 1;
+        if (X.empty())
+            return true;
+        if (!is_sorted(X.begin(), X.end()) || X.front() < m_tables->knots[m_p] || X.back() > m_tables->knots[n + 1])
+            return false;
+
+        const int m = n + m_p + 1;
+        const int r = X.size() - 1;
+        const int a = findSpan(X[0]);
+        const int b = findSpan(X[r]) + 1;
+
+        vector<glm::vec4> Pw = homogeneousPoints();
+        vector<glm::vec4> Qw(n + r + 2);
+        vector<float> knots(m + r + 2);
+
+        for (int j = 0; j <= a - m_p; j++)
+            Qw[j] = Pw[j];
+        for (int j = b - 1; j <= n; j++)
+            Qw[j + r + 1] = Pw[j];
+        for (int j = 0; j <= a; j++)
+            knots[j] = m_tables->knots[j];
+        for (int j = b + m_p; j <= m; j++)
+            knots[j + r + 1] = m_tables->knots[j];
+
+        // walk backwards, inserting X[j] into the partially built knot vector
+        int i = b + m_p - 1;
+        int k = b + m_p + r;
+        for (int j = r; j >= 0; j--)
+        {
+            while (X[j] <= m_tables->knots[i] && i > a)
+            {
+                Qw[k - m_p - 1] = Pw[i - m_p - 1];
+                knots[k] = m_tables->knots[i];
+                k--;
+                i--;
+            }
+            Qw[k - m_p - 1] = Qw[k - m_p];
+            for (int l = 1; l <= m_p; l++)
+            {
+                int ind = k - m_p + l;
+                float alpha = knots[k + l] - X[j];
+                if (alpha == 0.0f)
+                {
+                    Qw[ind - 1] = Qw[ind];
+                }
+                else
+                {
+                    alpha = alpha / (knots[k + l] - m_tables->knots[i - m_p + l]);
+                    Qw[ind - 1] = alpha * Qw[ind - 1] + (1.0f - alpha) * Qw[ind];
+                }
+            }
+            knots[k] = X[j];
+            k--;
+        }
+
+        m_tables = KnotTables::intern(knots, m_p);
+        setHomogeneousPoints(Qw);
+        m_segmentsValid = false;
+        m_arcLengthValid = false;
+        m_projectorValid = false;
+        return true;
+    }
+
+    /**
+     * @brief      Remove knot u up to num times while the curve stays within tol of the original
+     * @param[in]  u    Interior knot to remove
+     * @param[in]  num  Maximum number of removals, at most the multiplicity of u
+     * @param[in]  tol  Allowed deviation of the curve in model space
+     * @return     Number of knots actually removed
+     */
+    int RemoveKnot(const float u, const int num = 1, const float tol = 1e-5f)
+    {
+        const int s = knotMultiplicity(u);
+        if (s == 0)
+            return 0;
+
+        int n = m_controlPoints.size() - 1;
+        const int m = n + m_p + 1;
+        const int r = upper_bound(m_tables->knots.begin(), m_tables->knots.end(), u) - m_tables->knots.begin() - 1; // last index of u
+        if (r <= m_p || r >= n + 1)
+            return 0; // end knots of the domain
+
+        vector<glm::vec4> Pw = homogeneousPoints();
+
+        // homogeneous tolerance bound, see The NURBS Book (5.30)
+        float wmin = 1.0f, pmax = 0.0f;
+        for (int i = 0; i <= n; i++)
+        {
+            wmin = min(wmin, Pw[i].w);
+            pmax = max(pmax, glm::length(m_controlPoints[i]));
+        }
+        const float TOL = tol * wmin / (1.0f + pmax);
+
+        const int ord = m_p + 1;
+        const int fout = (2 * r - s - m_p) / 2;
+        int first = r - m_p;
+        int last = r - s;
+        vector<glm::vec4> temp(2 * m_p + 1);
+
+        // A5.8 removes at most the s copies of u
+        const int count = min(num, s);
+        int t = 0;
+        for (; t < count; t++)
+        {
+            // compute the new control points for one removal step
+            const int off = first - 1;
+            temp[0] = Pw[off];
+            temp[last + 1 - off] = Pw[last + 1];
+            int i = first, j = last;
+            int ii = 1, jj = last - off;
+            bool removable = false;
+            while (j - i > t)
+            {
+                float alphaI = (u - m_tables->knots[i]) / (m_tables->knots[i + ord + t] - m_tables->knots[i]);
+                float alphaJ = (u - m_tables->knots[j - t]) / (m_tables->knots[j + ord] - m_tables->knots[j - t]);
+                temp[ii] = (Pw[i] - (1.0f - alphaI) * temp[ii - 1]) / alphaI;
+                temp[jj] = (Pw[j] - alphaJ * temp[jj + 1]) / (1.0f - alphaJ);
+                i++;
+                ii++;
+                j--;
+                jj--;
+            }
+
+            // check whether the knot is removable
+            if (j - i < t)
+            {
+                removable = glm::length(temp[ii - 1] - temp[jj + 1]) <= TOL;
+            }
+            else
+            {
+                float alphaI = (u - m_tables->knots[i]) / (m_tables->knots[i + ord + t] - m_tables->knots[i]);
+                removable = glm::length(Pw[i] - (alphaI * temp[ii + t + 1] + (1.0f - alphaI) * temp[ii - 1])) <= TOL;
+            }
+            if (!removable)
+                break;
+
+            // save the new control points
+            i = first;
+            j = last;
+            while (j - i > t)
+            {
+                Pw[i] = temp[i - off];
+                Pw[j] = temp[j - off];
+                i++;
+                j--;
+            }
+            first--;
+            last++;
+        }
+        if (t == 0)
+            return 0;
+
+        // shift knots and control points down
+        vector<float> knots(m_tables->knots);
+        for (int k = r + 1; k <= m; k++)
+            knots[k - t] = knots[k];
+        int j = fout, i = fout;
+        for (int k = 1; k < t; k++)
+        {
+            if (k % 2 == 1)
+                i++;
+            else
+                j--;
+        }
+        for (int k = i + 1; k <= n; k++)
+        {
+            Pw[j] = Pw[k];
+            j++;
+        }
+        n -= t;
+        knots.resize(m - t + 1);
+        Pw.resize(n + 1);
+        m_tables = KnotTables::intern(knots, m_p);
+        setHomogeneousPoints(Pw);
+        m_segmentsValid = false;
+        m_arcLengthValid = false;
+        m_projectorValid = false;
+        return t;
+    }
+
+    // scratch memory for derivative evaluation in scalar type T, sized on first use so that later calls
+    // do not allocate
+    template <typename T>
+    struct DerivativeWorkspaceT
+    {
+        vector<T> ndu, left, right, a, basisDers;
+        vector<glm::vec<4, T>> Aders;
+    };
+    using DerivativeWorkspace = DerivativeWorkspaceT<float>;
+
+    /**
+     * @brief      Evaluate positions and derivatives for a batch of parameters
+     * @param[in]  us    Parameters, float or double; the evaluation runs in the same type
+     * @param[in]  k     Highest derivative order
+     * @param[out] ders  ders[i * (k + 1) + j] is the j-th derivative at us[i], j = 0 is the position
+     * @note       Basis function derivatives come from the same triangle as the basis functions,
+     *             rational curves use the quotient rule on the homogeneous derivatives
+     */
+    template <typename T>
+    void EvaluateDerivatives(const vector<T>& us, const int k, vector<glm::vec<3, T>>& ders) const
+    {
+        ders.assign(us.size() * (k + 1), glm::vec<3, T>(0));
+        DerivativeWorkspaceT<T> workspace;
+        for (int s = 0; s < (int)us.size(); s++)
+            EvaluateDerivatives(us[s], k, &ders[s * (k + 1)], workspace);
+    }
+
+    /**
+     * @brief      Nonzero basis functions at u and their derivatives, into workspace.basisDers
+     * @param[in]  u          Parameter
+     * @param[in]  k          Highest derivative order, at most the degree
+     * @param[in]  workspace  Scratch memory, also receives basisDers[j * (p + 1) + r], the j-th
+     *                        derivative of N_{span - p + r}
+     * @return     The knot span of u
+     */
+    template <typename T>
+    int EvaluateBasis(const T u, const int k, DerivativeWorkspaceT<T>& workspace) const
+    {
+        return evaluateBasis(m_tables->knots.data(), (int)m_controlPoints.size() - 1, m_p, u, k, workspace);
+    }
+
+    // EvaluateBasis over any knots array knots[0 .. n + p + 1], e.g. memory the curve does not own
+    template <typename T>
+    static int evaluateBasis(const float* knots, const int n, const int p, const T u, const int k, DerivativeWorkspaceT<T>& workspace)
+    {
+        if ((int)workspace.basisDers.size() < (k + 1) * (p + 1) || (int)workspace.ndu.size() < (p + 1) * (p + 1))
+        {
+            workspace.ndu.resize((p + 1) * (p + 1));
+            workspace.left.resize(p + 1);
+            workspace.right.resize(p + 1);
+            workspace.a.resize(2 * (p + 1));
+            workspace.basisDers.resize((k + 1) * (p + 1));
+        }
+        const int span = findSpan(knots, n, p, u);
+        dersBasisFuns(knots, p, span, u, k, workspace.ndu, workspace.left, workspace.right, workspace.a, workspace.basisDers);
+        return span;
+    }
+
+    /**
+     * @brief      Evaluate position and derivatives 0..k at u into ders[0..k]
+     * @note       Does not allocate once the workspace has been used with the same k, for real-time callers
+     */
+    template <typename T>
+    void EvaluateDerivatives(const T u, const int k, glm::vec<3, T>* ders, DerivativeWorkspaceT<T>& workspace) const
+    {
+        const int p = m_p;
+        const int du = min(k, p); // derivatives above the degree vanish
+        if ((int)workspace.Aders.size() < k + 1)
+            workspace.Aders.resize(k + 1);
+        const int span = EvaluateBasis(u, du, workspace);
+
+        glm::vec<4, T>* Aders = &workspace.Aders[0];
+        for (int j = 0; j <= k; j++)
+            Aders[j] = glm::vec<4, T>(0);
+        for (int j = 0; j <= du; j++)
+        {
+            for (int r = 0; r <= p; r++)
+                Aders[j] += workspace.basisDers[j * (p + 1) + r] * glm::vec<4, T>(m_Pw[span - p + r]);
+        }
+
+        if (m_isRational)
+        {
+            rationalDerivatives(Aders, k, ders);
+        }
+        else
+        {
+            for (int j = 0; j <= k; j++)
+                ders[j] = glm::vec<3, T>(Aders[j]);
+        }
+    }
+
+    /**
+     * @brief      Piecewise Bezier form of the curve, extracted on first use and cached
+     *             until the knots or control points change
+     * @note       Covers the domain [knots[p], knots[n + 1]], clamped or not
+     */
+    const BezierSegments& GetBezierSegments() const
+    {
+        if (!m_segmentsValid)
+        {
+            m_segments.build(homogeneousPoints(), m_tables->knots, m_p);
+            m_segmentsValid = true;
+        }
+        return m_segments;
+    }
+
+    /**
+     * @brief      Arc length index over the knot spans, built on first use; moving a control point
+     *             only re-integrates the p + 1 spans it influences
+     */
+    const ArcLengthTable& GetArcLength() const
+    {
+        if (!m_arcLengthValid)
+        {
+            vector<float> breaks;
+            const int n = m_controlPoints.size() - 1;
+            for (int i = m_p; i <= n + 1; i++)
+            {
+                if (breaks.empty() || m_tables->knots[i] > breaks.back())
+                    breaks.push_back(m_tables->knots[i]);
+            }
+            m_arcLength.build(*this, breaks, 4);
+            m_arcLengthValid = true;
+        }
+        m_arcLength.update(*this);
+        return m_arcLength;
+    }
+
+    // parameters of count + 1 points equally spaced in arc length
+    void SampleByArcLength(const int count, vector<float>& us) const
+    {
+        GetArcLength().equalSpacing(*this, count, us);
+    }
+
+    // closest point on the curve to x
+    CurveProjector::Result Project(const glm::vec3& x) const
+    {
+        return getProjector().project(x);
+    }
+
+    /**
+     * @brief      Closest points for many query points
+     * @param[in]  points   Query points
+     * @param[out] results  One result per query point
+     * @param[in]  threads  Worker threads, 0 for the hardware concurrency
+     */
+    void ProjectBatch(const vector<glm::vec3>& points, vector<CurveProjector::Result>& results, const int threads = 0) const
+    {
+        getProjector().projectBatch(points, results, threads);
+    }
+
+    /**
+     * @brief      Intersections with another curve (BsplineCurve or BezierCurve)
+     * @param[in]  other      The other curve
+     * @param[in]  tolerance  Distance below which the curves count as intersecting
+     * @param[out] out        Intersections, u0 on this curve and u1 on the other
+     */
+    template <class Curve>
+    void Intersect(const Curve& other, const float tolerance, vector<CurveIntersection>& out) const
+    {
+        out.clear();
+        CurveIntersector().intersect(GetBezierSegments(), other.GetBezierSegments(), tolerance, out);
+    }
+
+    // intersections with the ray origin + t * direction, t >= 0
+    void IntersectRay(const glm::vec3& origin, const glm::vec3& direction, const float tolerance, vector<RayIntersection>& out) const
+    {
+        out.clear();
+        CurveIntersector().intersectRay(GetBezierSegments(), origin, direction, tolerance, out);
+    }
+
+    // replace all control points (e.g. with a fitted result), the count has to match the knots array
+    void SetControlPoints(const vector<glm::vec3>& controlPoints)
+    {
+        m_controlPoints = controlPoints;
+        updateHomogeneousPoints();
+        m_segmentsValid = false;
+        m_arcLengthValid = false;
+        m_projectorValid = false;
+    }
+
+    const vector<float>& GetKnots() const
+    {
+        return m_tables->knots;
+    }
+
+    // knots and derived tables, shared with every curve of the same knots and degree
+    const shared_ptr<const KnotTables>& GetKnotTables() const
+    {
+        return m_tables;
+    }
+
+    int GetDegree() const
     {
+        return m_p;
+    }
+
+    /**
+     * @brief      Tessellate by subdividing the control polygon instead of evaluating points
+     * @param[in]  level  Number of Lane-Riesenfeld refinements (Chaikin for p = 2), 0 evaluates points
+     * @note       Only used for uniform knots arrays, other curves keep point evaluation. The vertex count
+     *             follows from the level, about (n + 1 - p) * 2^level + 1, instead of the segment count
+     */
+    void SetSubdivisionLevel(const int level)
+    {
+        m_subdivisionLevel = max(level, 0);
+    }
+
+    int GetSubdivisionLevel() const
+    {
+        return m_subdivisionLevel;
     }
 
 protected:
     int m_p; // degree
-    vector<float> m_knots; // knots array
-    vector<float> m_weights; // weights of control points
+    shared_ptr<const KnotTables> m_tables; // knots array and derived tables, shared between equal knots
     bool m_isRational;       // rational bspline curve or not
+    // homogeneous control points (w * P, w), the only copy of the weights. Evaluation reads these, so its
+    // inner loops neither multiply by the weights nor branch on them; m_controlPoints is the Cartesian
+    // copy that GetControlPoints(), editing and the control polygon draw work on, kept in sync by
+    // updateHomogeneousPoint() and setHomogeneousPoints()
+    vector<glm::vec4> m_Pw;
+
+    mutable BezierSegments m_segments; // cached Bezier extraction
+    mutable bool m_segmentsValid = false;
+
+    mutable ArcLengthTable m_arcLength; // cached arc length index
+    mutable bool m_arcLengthValid = false;
+
+    mutable CurveProjector m_projector; // cached closest point hierarchy
+    mutable bool m_projectorValid = false;
+
+    const CurveProjector& getProjector() const
+    {
+        if (!m_projectorValid)
+        {
+            m_projector.build(GetBezierSegments());
+            m_projectorValid = true;
+        }
+        return m_projector;
+    }
+
+    void onControlPointMoved(const unsigned int id) override
+    {
+        updateHomogeneousPoint(id);
+        m_segmentsValid = false;
+        m_projectorValid = false;
+        if (m_arcLengthValid)
+            m_arcLength.invalidate(m_tables->knots[id], m_tables->knots[id + m_p + 1]);
+    }
+
+    // knot span index k with knots[k] <= u < knots[k + 1], clamped to the valid spans [p, n]
+    template <typename T>
+    int findSpan(const T u) const
+    {
+        return findSpan(m_tables->knots.data(), (int)m_controlPoints.size() - 1, m_p, u);
+    }
+
+    template <typename T>
+    static int findSpan(const float* knots, const int n, const int p, const T u)
+    {
+        if (u >= knots[n + 1])
+            return n;
+        if (u <= knots[p])
+            return p;
+        return upper_bound(knots + p, knots + n + 1, u) - knots - 1;
+    }
+
+    int knotMultiplicity(const float u) const
+    {
+        auto range = equal_range(m_tables->knots.begin(), m_tables->knots.end(), u);
+        return range.second - range.first;
+    }
+
+    // nonzero basis functions of span and their derivatives up to order n (The NURBS Book A2.3),
+    // ders[k * (p + 1) + j] is the k-th derivative of N_{span - p + j}
+    // in scalar type T, the knots are widened from float
+    template <typename T>
+    static void dersBasisFuns(const float* knots,
+                              const int p,
+                              const int span,
+                              const T u,
+                              const int n,
+                              vector<T>& ndu,
+                              vector<T>& left,
+                              vector<T>& right,
+                              vector<T>& a,
+                              vector<T>& ders)
+    {
+        const int stride = p + 1;
+
+        // basis functions and knot differences, ndu[j * stride + r] holds row j column r
+        ndu[0] = T(1);
+        for (int j = 1; j <= p; j++)
+        {
+            left[j] = u - (T)knots[span + 1 - j];
+            right[j] = (T)knots[span + j] - u;
+            T saved = T(0);
+            for (int r = 0; r < j; r++)
+            {
+                ndu[j * stride + r] = right[r + 1] + left[j - r];
+                T temp = ndu[r * stride + j - 1] / ndu[j * stride + r];
+                ndu[r * stride + j] = saved + right[r + 1] * temp;
+                saved = left[j - r] * temp;
+            }
+            ndu[j * stride + j] = saved;
+        }
+        for (int j = 0; j <= p; j++)
+            ders[j] = ndu[j * stride + p];
+
+        // derivatives, a holds two alternating rows of coefficients
+        for (int r = 0; r <= p; r++)
+        {
+            int s1 = 0, s2 = stride;
+            a[0] = T(1);
+            for (int k = 1; k <= n; k++)
+            {
+                T d = T(0);
+                const int rk = r - k, pk = p - k;
+                if (r >= k)
+                {
+                    a[s2] = a[s1] / ndu[(pk + 1) * stride + rk];
+                    d = a[s2] * ndu[rk * stride + pk];
+                }
+                const int j1 = rk >= -1 ? 1 : -rk;
+                const int j2 = r - 1 <= pk ? k - 1 : p - r;
+                for (int j = j1; j <= j2; j++)
+                {
+                    a[s2 + j] = (a[s1 + j] - a[s1 + j - 1]) / ndu[(pk + 1) * stride + rk + j];
+                    d += a[s2 + j] * ndu[(rk + j) * stride + pk];
+                }
+                if (r <= pk)
+                {
+                    a[s2 + k] = -a[s1 + k - 1] / ndu[(pk + 1) * stride + r];
+                    d += a[s2 + k] * ndu[r * stride + pk];
+                }
+                ders[k * stride + r] = d;
+                swap(s1, s2);
+            }
+        }
+
+        // multiply by p! / (p - k)!
+        T factor = (T)p;
+        for (int k = 1; k <= n; k++)
+        {
+            for (int j = 0; j <= p; j++)
+                ders[k * stride + j] *= factor;
+            factor *= (T)(p - k);
+        }
+    }
+
+    // control points in homogeneous form (w * P, w), w = 1 for non-rational curves
+    const vector<glm::vec4>& homogeneousPoints() const
+    {
+        return m_Pw;
+    }
+
+    // homogeneous control points from m_controlPoints and weights, all 1 when empty
+    void initHomogeneousPoints(const vector<float>& weights)
+    {
+        m_Pw.resize(m_controlPoints.size());
+        for (int i = 0; i < (int)m_Pw.size(); i++)
+        {
+            const float w = weights.empty() ? 1.0f : weights[i];
+            m_Pw[i] = glm::vec4(m_controlPoints[i] * w, w);
+        }
+    }
+
+    // rebuild the homogeneous control points from m_controlPoints, keeping their weights
+    void updateHomogeneousPoints()
+    {
+        m_Pw.resize(m_controlPoints.size(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        for (int i = 0; i < (int)m_Pw.size(); i++)
+            updateHomogeneousPoint(i);
+    }
+
+    void updateHomogeneousPoint(const int i)
+    {
+        const float w = m_Pw[i].w;
+        m_Pw[i] = glm::vec4(m_controlPoints[i] * w, w);
+    }
+
+    void setHomogeneousPoints(const vector<glm::vec4>& Pw)
+    {
+        m_Pw = Pw;
+        m_controlPoints.resize(Pw.size());
+        for (int i = 0; i < (int)Pw.size(); i++)
+            m_controlPoints[i] = glm::vec3(Pw[i]) / Pw[i].w;
+    }
 
 private:
+    vector<float> m_basis; // basis function scratch buffer, reused between samples
+
+    vector<glm::dvec4> m_differences; // forward differencing table, reused between spans
+
+    int m_subdivisionLevel = 0;
+    vector<glm::vec4> m_refined[2]; // ping-pong buffers of the subdivided homogeneous control polygon
+
     // create draw vertices according to control points and parameter domain
     void createDrawVertices() override
     {
+        const KnotTables& tables = *m_tables;
+        m_basis.resize(m_p + 1);
+        if (m_subdivisionLevel > 0 && tables.uniformKnots && (int)m_controlPoints.size() > m_p)
+        {
+            createSubdivisionVertices();
+            return;
+        }
+        m_vertices.reserve(m_count + 1);
+
         float u = 0;
         float delta = 1.0f / (float)m_count;
-        for (int i = 0; i <= m_count; i++)
+        if (!tables.hasUniformSpans)
         {
-            createVertexByU(u);
-            u += delta;
+            for (int i = 0; i <= m_count; i++)
+                createVertexByU((float)i * delta); // not accumulated, no drift over many samples
+            return;
+        }
+
+        // uniform spans: whole runs of samples by forward differencing, other spans sample by sample
+        const int n = m_controlPoints.size() - 1;
+        int i = 0;
+        while (i <= m_count)
+        {
+            u = (float)i * delta;
+            const int span = u >= tables.knots[m_p] && u < tables.knots[n + 1] ? findSpan(u) : -1;
+            if (span < 0 || !tables.uniformSpan[span])
+            {
+                createVertexByU(u);
+                i++;
+                continue;
+            }
+            const int last = min(m_count, max(i, (int)ceil(tables.knots[span + 1] / delta) - 1));
+            createUniformSpanVertices(span, i, last, delta);
+            i = last + 1;
+        }
+    }
+
+    // Lane-Riesenfeld: every level duplicates the control points and averages neighbours p times, which
+    // gives the control polygon of the same curve over knots spaced half as wide. The polygon is mapped
+    // onto the curve at the refined knots with the row t = 0 of the uniform basis matrix.
+    void createSubdivisionVertices()
+    {
+        const KnotTables& tables = *m_tables;
+        const int p = m_p;
+        const int order = p + 1;
+        int size = m_controlPoints.size();
+        int levelSize = size;
+        for (int level = 0; level < m_subdivisionLevel; level++)
+            levelSize = 2 * levelSize - p;
+        m_vertices.reserve(levelSize - p + 1);
+        m_refined[0].resize(levelSize + p);
+        m_refined[1].resize(levelSize + p);
+
+        glm::vec4* src = m_refined[0].data();
+        glm::vec4* dst = m_refined[1].data();
+        copy(m_Pw.begin(), m_Pw.end(), src);
+        for (int level = 0; level < m_subdivisionLevel; level++)
+        {
+            for (int i = 0; i < size; i++)
+                dst[2 * i] = dst[2 * i + 1] = src[i];
+            for (int pass = 0; pass < p; pass++)
+                for (int i = 0; i < 2 * size - pass - 1; i++)
+                    dst[i] = 0.5f * (dst[i] + dst[i + 1]);
+            size = 2 * size - p;
+            swap(src, dst);
+        }
+
+        // curve points at the refined knots; the last one is the end of the last span (t = 1)
+        const float* M = &tables.uniformBasis[0];
+        for (int span = p; span < size; span++)
+        {
+            glm::vec4 point(0.0f);
+            for (int r = 0; r <= p; r++)
+                point += M[r * order] * src[span - p + r];
+            m_vertices.push_back(m_isRational ? glm::vec3(point) / point.w : glm::vec3(point));
+        }
+        glm::vec4 point(0.0f);
+        for (int r = 0; r <= p; r++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k <= p; k++)
+                sum += M[r * order + k];
+            point += sum * src[size - 1 - p + r];
+        }
+        m_vertices.push_back(m_isRational ? glm::vec3(point) / point.w : glm::vec3(point));
+    }
+
+    // samples first .. last (u = index * delta) of a uniform span: local polynomial coefficients from the
+    // constant basis matrix, then p additions per sample, no knot lookups or divisions. The table is kept
+    // in double: in float the rounding of every addition piles up over a long run of samples.
+    void createUniformSpanVertices(const int span, const int first, const int last, const float delta)
+    {
+        const KnotTables& tables = *m_tables;
+        const int p = m_p;
+        const int order = p + 1;
+        const double h = (double)tables.knots[span + 1] - (double)tables.knots[span];
+        const double t0 = ((double)first * (double)delta - (double)tables.knots[span]) / h;
+        const double dt = (double)delta / h;
+
+        // power basis coefficients of the homogeneous span polynomial
+        m_differences.resize(2 * order);
+        glm::dvec4* coefficients = &m_differences[order];
+        for (int k = 0; k <= p; k++)
+            coefficients[k] = glm::dvec4(0.0);
+        for (int r = 0; r <= p; r++)
+        {
+            const glm::dvec4 Pw(m_Pw[span - p + r]);
+            for (int k = 0; k <= p; k++)
+                coefficients[k] += (double)tables.uniformBasis[r * order + k] * Pw;
+        }
+
+        // expand in the sample index, P(s) = sum_j b_j s^j with t = t0 + s dt, then the forward differences
+        // at s = 0 follow without cancellation: Delta^j P(0) = sum_k j! S(k, j) b_k (S: Stirling numbers)
+        glm::dvec4* b = coefficients; // b_j overwrites c_j, which later b_j do not need
+        double dtPower = 1.0;
+        for (int j = 0; j <= p; j++)
+        {
+            glm::dvec4 sum(0.0);
+            double weight = dtPower; // C(k, j) t0^(k - j) dt^j
+            for (int k = j; k <= p; k++)
+            {
+                sum += weight * coefficients[k];
+                weight *= t0 * (double)(k + 1) / (double)(k + 1 - j);
+            }
+            b[j] = sum;
+            dtPower *= dt;
+        }
+        glm::dvec4* D = &m_differences[0];
+        for (int j = 0; j <= p; j++)
+        {
+            D[j] = glm::dvec4(0.0);
+            for (int k = j; k <= p; k++)
+                D[j] += (double)tables.differenceBasis[k * order + j] * b[k];
+        }
+
+        for (int s = first; s <= last; s++)
+        {
+            m_vertices.push_back(glm::vec3(m_isRational ? glm::dvec3(D[0]) / D[0].w : glm::dvec3(D[0])));
+            for (int j = 0; j < p; j++)
+                D[j] += D[j + 1];
         }
     }
 
     // create vertex by parameter u
     void createVertexByU(const float u)
     {
+        const KnotTables& tables = *m_tables;
         const int size = m_controlPoints.size();
-        const int pos = upper_bound(m_knots.begin(), m_knots.end(), u) - m_knots.begin() - 1;
-        vector<float> basis_func(m_p+1, 0.0f);
+        int pos = upper_bound(tables.knots.begin(), tables.knots.end(), u) - tables.knots.begin() - 1;
+        const int m = tables.knots.size();
+        if (pos == m - 1) // u at the last knot: limit from the last nonempty span, not an all-zero basis
+            pos = lower_bound(tables.knots.begin(), tables.knots.end(), tables.knots.back()) - tables.knots.begin() - 1;
+        const float* knots = tables.knots.data();
+
+        float* basis_func = m_basis.data();
+        fill(m_basis.begin(), m_basis.end(), 0.0f);
         basis_func[0] = 1.0f;
         for (int i = 1; i <= m_p; i++)
         {
+            const float* reciprocal = &tables.reciprocals[(i - 1) * m];
             for (int j = i; j >= 0; j--) // reverse order make sure the update of basis function is correct
-			{
-                int k = pos - i + j;
-                if (k < 0 || k >= m_knots.size() - i - 1) continue;
-                
+            {
+                const int k = pos - i + j;
+                if (k < 0 || k >= m - i - 1)
+                    continue;
                 if (j == 0)
-                {
-                    basis_func[j] = (m_knots[k + i + 1] - u) / (m_knots[k + i + 1] - m_knots[k + 1]) * basis_func[j];
-                }
+                    basis_func[j] = (knots[k + i + 1] - u) * reciprocal[k + 1] * basis_func[j];
                 else if (j == i)
-                {
-                    basis_func[j] = (u - m_knots[k]) / (m_knots[k + i] - m_knots[k]) * basis_func[j - 1];
-                }
+                    basis_func[j] = (u - knots[k]) * reciprocal[k] * basis_func[j - 1];
                 else
-                {
-                    basis_func[j] = (u - m_knots[k]) / (m_knots[k + i] - m_knots[k]) * basis_func[j - 1] +
-                        (m_knots[k + i + 1] - u) / (m_knots[k + i + 1] - m_knots[k + 1]) * basis_func[j];
-                }
+                    basis_func[j] = (u - knots[k]) * reciprocal[k] * basis_func[j - 1] +
+                        (knots[k + i + 1] - u) * reciprocal[k + 1] * basis_func[j];
             }
         }
-        glm::vec3 vertex(0.0f);
-        if (!m_isRational) // non-rational condition
+        // one homogeneous blend for both cases, rational curves divide once
+        glm::vec4 point(0.0f);
+        const glm::vec4* Pw = m_Pw.data();
+        for (int i = m_p; i >= 0; i--)
         {
-            for (int i = m_p; i >= 0; i--)
-		    {
-                if (pos - i >= 0 && pos - i < size)
-                {
-                    vertex += m_controlPoints[pos - i] * basis_func[m_p - i];
-		        }
-            }
-        }
-        else // rational condition
-        {
-            float w = 0.0f;
-            for (int i = m_p; i >= 0; i--)
-            {
-                if (pos - i >= 0 && pos - i < size)
-                {
-                    vertex += m_controlPoints[pos - i] * m_weights[pos - i] * basis_func[m_p - i];
-                    w += m_weights[pos - i] * basis_func[m_p - i];
-                }
-            }
-            vertex /= w;
+            if (pos - i >= 0 && pos - i < size)
+                point += Pw[pos - i] * basis_func[m_p - i];
         }
+        glm::vec3 vertex = m_isRational ? glm::vec3(point) / point.w : glm::vec3(point);
 
         m_vertices.push_back(vertex);
     }
@@ -0,0 +1,111 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include "bspline.h"
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Non-rational B-spline with any number of scalar channels (animation tracks, colour components, ...)
+// over one knots array.
+//
+// Control point i keeps its channels next to each other at m_values[i * channels + c]. Every parameter
+// takes one basis evaluation, which is applied to all channels at once: the inner loop runs over the
+// contiguous channels of a control point and vectorizes, instead of recomputing the same basis for every
+// scalar curve.
+class BsplineChannels
+{
+public:
+    /**
+     * @brief      Multi-channel curve constructor, all control points start at 0
+     * @param[in]  knots     Knots array, defines the number of control points
+     * @param[in]  p         Degree
+     * @param[in]  channels  Number of scalar channels per control point
+     */
+    BsplineChannels(const vector<float>& knots, const int p, const int channels)
+        : m_tables(KnotTables::intern(knots, p))
+        , m_p(p)
+        , m_channels(channels)
+        , m_values((knots.size() - p - 1) * channels, 0.0f)
+    {
+    }
+
+    int channels() const
+    {
+        return m_channels;
+    }
+
+    // number of control points
+    int size() const
+    {
+        return m_values.size() / m_channels;
+    }
+
+    // size() * channels() values, control point major; false and nothing changed for any other count
+    bool setControlPoints(const vector<float>& values)
+    {
+        if (values.size() != m_values.size())
+            return false;
+        copy(values.begin(), values.end(), m_values.begin());
+        return true;
+    }
+
+    // the channels of control point i
+    float* controlPoint(const int i)
+    {
+        return &m_values[i * m_channels];
+    }
+
+    const float* controlPoint(const int i) const
+    {
+        return &m_values[i * m_channels];
+    }
+
+    // knots array and degree, shared with the curves built over the same knots
+    const KnotTables& tables() const
+    {
+        return *m_tables;
+    }
+
+    /**
+     * @brief      Evaluate all channels and their derivatives 0..k at u
+     * @param[out] out        out[j * channels + c] is the j-th derivative of channel c
+     * @param[in]  workspace  Scratch memory, no allocations once it has been used with the same k
+     */
+    void evaluate(const float u, const int k, float* out, BsplineCurve::DerivativeWorkspace& workspace) const
+    {
+        const int p = m_p;
+        const int channels = m_channels;
+        const int du = min(k, p); // derivatives above the degree vanish
+        fill(out, out + (k + 1) * channels, 0.0f);
+        const int span = BsplineCurve::evaluateBasis(m_tables->knots.data(), size() - 1, p, u, du, workspace);
+        for (int j = 0; j <= du; j++)
+        {
+            float* row = out + j * channels;
+            for (int r = 0; r <= p; r++)
+            {
+                const float N = workspace.basisDers[j * (p + 1) + r];
+                const float* P = &m_values[(span - p + r) * channels];
+                for (int c = 0; c < channels; c++)
+                    row[c] += N * P[c];
+            }
+        }
+    }
+
+    // batch form, out[(s * (k + 1) + j) * channels + c] is the j-th derivative of channel c at us[s]
+    void evaluate(const vector<float>& us, const int k, vector<float>& out) const
+    {
+        out.resize(us.size() * (k + 1) * m_channels);
+        BsplineCurve::DerivativeWorkspace workspace;
+        for (int s = 0; s < (int)us.size(); s++)
+            evaluate(us[s], k, &out[s * (k + 1) * m_channels], workspace);
+    }
+
+private:
+    shared_ptr<const KnotTables> m_tables; // knots array
+    int m_p;
+    int m_channels;
+    vector<float> m_values; // m_values[i * m_channels + c] is channel c of control point i
+};
+#endif
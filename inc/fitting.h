@@ -0,0 +1,278 @@
+#ifndef FITTING_H
+#define FITTING_H
+
+#include "bspline.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Least squares fit of B-spline control points to measured points for a fixed knots array and degree.
+//
+// Every point touches only the p + 1 basis functions of its span, so the normal equations N^T N P = N^T X
+// are banded with half bandwidth p. They are accumulated in one streaming pass over the points (in double,
+// per thread over contiguous chunks, then summed) and solved with a banded Cholesky factorization in
+// O(n p^2). Parameter correction projects every point back onto the fitted curve and refits.
+class BsplineFitter
+{
+public:
+    /**
+     * @brief      Fitter constructor
+     * @param[in]  knots  Clamped knots array, defines the number of control points
+     * @param[in]  p      Degree
+     */
+    BsplineFitter(const vector<float>& knots, const int p = 3)
+        : m_curve(vector<glm::vec3>(knots.size() - p - 1, glm::vec3(0.0f)), knots, p), m_p(p)
+    {
+    }
+
+    /**
+     * @brief      Fit the control points
+     * @param[in]  points       Measured points, in curve order
+     * @param[in]  params       Parameters of the points, chord length parameters are used when empty;
+     *                          receives the corrected parameters
+     * @param[in]  corrections  Parameter correction iterations, each one refits
+     * @param[in]  threads      Worker threads, 0 for the hardware concurrency
+     * @return     false if the normal equations are singular, i.e. some control point has no data
+     */
+    bool fit(const vector<glm::vec3>& points, vector<float>& params, const int corrections = 0, int threads = 0)
+    {
+        if (points.empty())
+            return false;
+        if (params.size() != points.size())
+            chordLengthParameters(points, params);
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        threads = min(threads, max(1, (int)points.size() / 16384)); // not worth a thread for small inputs
+
+        for (int iteration = 0; iteration <= corrections; iteration++)
+        {
+            if (iteration > 0)
+                correctParameters(points, params, threads);
+            accumulate(points, params, threads);
+            if (!solve())
+                return false;
+            m_curve.SetControlPoints(m_controlPoints);
+        }
+        return true;
+    }
+
+    const vector<glm::vec3>& controlPoints() const
+    {
+        return m_controlPoints;
+    }
+
+    // the fitted curve, evaluation only (no draw vertices)
+    const BsplineCurve& curve() const
+    {
+        return m_curve;
+    }
+
+    // root mean square distance between the points and the curve at their parameters
+    float residual(const vector<glm::vec3>& points, const vector<float>& params) const
+    {
+        BsplineCurve::DerivativeWorkspace workspace;
+        glm::vec3 position;
+        double sum = 0.0;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            m_curve.EvaluateDerivatives(params[i], 0, &position, workspace);
+            sum += (double)glm::dot(position - points[i], position - points[i]);
+        }
+        return points.empty() ? 0.0f : (float)sqrt(sum / (double)points.size());
+    }
+
+    /**
+     * @brief      Banded Cholesky A = U^T U in place, then forward and back substitution
+     * @param[in]  band       band[i * (bandwidth + 1) + d] = A(i, i + d) of the symmetric matrix A,
+     *                        replaced by U
+     * @param[in]  rhs        Right hand sides, replaced by the solution
+     * @param[in]  bandwidth  Half bandwidth
+     * @return     false if A is not positive definite
+     */
+    static bool solveBanded(vector<double>& band, vector<glm::dvec3>& rhs, const int bandwidth)
+    {
+        const int size = rhs.size();
+        const int stride = bandwidth + 1;
+        vector<double>& U = band; // U(i, i + d) at U[i * stride + d]
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = i; j <= min(size - 1, i + bandwidth); j++)
+            {
+                double sum = U[i * stride + j - i];
+                for (int k = max(0, j - bandwidth); k < i; k++)
+                    sum -= U[k * stride + i - k] * U[k * stride + j - k];
+                if (j == i)
+                {
+                    if (sum <= 0.0)
+                        return false;
+                    U[i * stride] = sqrt(sum);
+                }
+                else
+                {
+                    U[i * stride + j - i] = sum / U[i * stride];
+                }
+            }
+        }
+
+        // U^T y = b
+        for (int i = 0; i < size; i++)
+        {
+            glm::dvec3 sum = rhs[i];
+            for (int k = max(0, i - bandwidth); k < i; k++)
+                sum -= U[k * stride + i - k] * rhs[k];
+            rhs[i] = sum / U[i * stride];
+        }
+        // U x = y
+        for (int i = size - 1; i >= 0; i--)
+        {
+            glm::dvec3 sum = rhs[i];
+            for (int j = i + 1; j <= min(size - 1, i + bandwidth); j++)
+                sum -= U[i * stride + j - i] * rhs[j];
+            rhs[i] = sum / U[i * stride];
+        }
+        return true;
+    }
+
+private:
+    BsplineCurve m_curve; // knots, degree and basis functions; holds the latest fit
+    int m_p;
+    vector<glm::vec3> m_controlPoints;
+
+    // normal equations: m_band[i * (p + 1) + d] = (N^T N)(i, i + d), m_rhs = N^T X
+    vector<double> m_band;
+    vector<glm::dvec3> m_rhs;
+
+    // partial sums of one thread
+    struct Accumulator
+    {
+        vector<double> band;
+        vector<glm::dvec3> rhs;
+    };
+
+    // chord length parameters mapped onto the knot domain
+    void chordLengthParameters(const vector<glm::vec3>& points, vector<float>& params) const
+    {
+        const vector<float>& knots = m_curve.GetKnots();
+        const float u0 = knots[m_p], u1 = knots[knots.size() - m_p - 1];
+        params.resize(points.size());
+        vector<double> lengths(points.size(), 0.0);
+        for (size_t i = 1; i < points.size(); i++)
+            lengths[i] = lengths[i - 1] + (double)glm::length(points[i] - points[i - 1]);
+        const double total = lengths.back();
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const double t = total > 0.0 ? lengths[i] / total : (double)i / (double)max((size_t)1, points.size() - 1);
+            params[i] = u0 + (float)t * (u1 - u0);
+        }
+    }
+
+    void accumulateRange(const vector<glm::vec3>& points, const vector<float>& params, const size_t first, const size_t last, Accumulator& sum) const
+    {
+        const int stride = m_p + 1;
+        const int size = m_curve.GetControlPoints().size();
+        sum.band.assign(size * stride, 0.0);
+        sum.rhs.assign(size, glm::dvec3(0.0));
+        BsplineCurve::DerivativeWorkspace workspace;
+        for (size_t s = first; s < last; s++)
+        {
+            const int span = m_curve.EvaluateBasis(params[s], 0, workspace);
+            const float* basis = &workspace.basisDers[0];
+            const glm::dvec3 x(points[s]);
+            for (int r = 0; r <= m_p; r++)
+            {
+                const int i = span - m_p + r;
+                double* row = &sum.band[i * stride];
+                sum.rhs[i] += (double)basis[r] * x;
+                for (int c = r; c <= m_p; c++)
+                    row[c - r] += (double)basis[r] * (double)basis[c];
+            }
+        }
+    }
+
+    // streaming pass over all points, one accumulator per thread, summed at the end
+    void accumulate(const vector<glm::vec3>& points, const vector<float>& params, const int threads)
+    {
+        vector<Accumulator> sums(threads);
+        if (threads == 1)
+        {
+            accumulateRange(points, params, 0, points.size(), sums[0]);
+        }
+        else
+        {
+            vector<thread> workers;
+            const size_t chunk = (points.size() + threads - 1) / threads;
+            for (int t = 0; t < threads; t++)
+            {
+                const size_t first = min(points.size(), t * chunk), last = min(points.size(), first + chunk);
+                workers.emplace_back(&BsplineFitter::accumulateRange, this, cref(points), cref(params), first, last, ref(sums[t]));
+            }
+            for (thread& worker : workers)
+                worker.join();
+        }
+
+        m_band.swap(sums[0].band);
+        m_rhs.swap(sums[0].rhs);
+        for (int t = 1; t < threads; t++)
+        {
+            for (size_t i = 0; i < m_band.size(); i++)
+                m_band[i] += sums[t].band[i];
+            for (size_t i = 0; i < m_rhs.size(); i++)
+                m_rhs[i] += sums[t].rhs[i];
+        }
+    }
+
+    bool solve()
+    {
+        if (!solveBanded(m_band, m_rhs, m_p))
+            return false;
+        m_controlPoints.resize(m_rhs.size());
+        for (size_t i = 0; i < m_rhs.size(); i++)
+            m_controlPoints[i] = glm::vec3(m_rhs[i]);
+        return true;
+    }
+
+    // Newton steps on (C(u) - x) . C'(u) = 0 from the current parameter of every point
+    void correctParameters(const vector<glm::vec3>& points, vector<float>& params, const int threads) const
+    {
+        const vector<float>& knots = m_curve.GetKnots();
+        const float u0 = knots[m_p], u1 = knots[knots.size() - m_p - 1];
+        auto work = [&](const size_t first, const size_t last) {
+            BsplineCurve::DerivativeWorkspace workspace;
+            glm::vec3 ders[3];
+            for (size_t s = first; s < last; s++)
+            {
+                float u = params[s];
+                for (int step = 0; step < 2; step++)
+                {
+                    m_curve.EvaluateDerivatives(u, 2, ders, workspace);
+                    const glm::vec3 d = ders[0] - points[s];
+                    const float df = glm::dot(ders[2], d) + glm::dot(ders[1], ders[1]);
+                    if (df <= 0.0f)
+                        break;
+                    u = min(max(u - glm::dot(ders[1], d) / df, u0), u1);
+                }
+                params[s] = u;
+            }
+        };
+        if (threads == 1)
+        {
+            work(0, points.size());
+            return;
+        }
+        vector<thread> workers;
+        const size_t chunk = (points.size() + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            const size_t first = min(points.size(), t * chunk), last = min(points.size(), first + chunk);
+            workers.emplace_back(work, first, last);
+        }
+        for (thread& worker : workers)
+            worker.join();
+    }
+};
+#endif
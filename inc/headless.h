@@ -0,0 +1,99 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#ifdef BSPLINE_HAS_EGL
+
+#include <glad/glad.h>
+
+#ifndef EGL_NO_X11
+#define EGL_NO_X11 // keep X11 headers out, we never create a native window here
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+// OpenGL 3.3 core context without any window or display server (EGL surfaceless, e.g. Mesa llvmpipe).
+// Rendering has to go to a framebuffer object since there is no default framebuffer.
+class HeadlessContext
+{
+public:
+    ~HeadlessContext()
+    {
+        destroy();
+    }
+
+    // create the context, make it current and load the OpenGL function pointers
+    bool create()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (m_display == EGL_NO_DISPLAY)
+            m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+        {
+            std::cout << "ERROR::EGL:: Failed to initialize display" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR::EGL:: OpenGL API not supported" << std::endl;
+            return false;
+        }
+
+        // a config is optional with EGL_KHR_no_config_context, surfaceless drivers often expose none
+        const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = (EGLConfig)0;
+        EGLint numConfigs = 0;
+        eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs);
+
+        const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                         3,
+                                         EGL_CONTEXT_MINOR_VERSION,
+                                         3,
+                                         EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                         EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                         EGL_NONE};
+        m_context = eglCreateContext(m_display, numConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if (m_context == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::EGL:: Failed to create OpenGL 3.3 core context" << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+        {
+            std::cout << "ERROR::EGL:: Surfaceless context not supported" << std::endl;
+            return false;
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void destroy()
+    {
+        if (m_display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_context != EGL_NO_CONTEXT)
+            eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+        m_display = EGL_NO_DISPLAY;
+        m_context = EGL_NO_CONTEXT;
+    }
+
+private:
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLContext m_context = EGL_NO_CONTEXT;
+};
+
+#endif
+#endif
@@ -0,0 +1,280 @@
+#ifndef INTERPOLATOR_H
+#define INTERPOLATOR_H
+
+#include "bspline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Real-time feed-rate interpolator for motion along a (NURBS) BsplineCurve.
+//
+// plan() is the look-ahead stage: it samples the curve at equal arc length, limits the speed by
+// curvature (centripetal acceleration and jerk) and runs a backward and a forward pass so that the
+// profile can be followed with the acceleration limit, starting and ending at rest.
+//
+// tick() produces one setpoint per control period. The parameter advances with a second order
+// Taylor step on the curve derivatives (predictor) followed by one chord length correction
+// (corrector). The distance travelled is measured on the curve, from the chord between consecutive
+// setpoints, so the remaining length the speed command brakes for is the real one. Every tick keeps
+// the acceleration and jerk limits and, close to the end, takes the largest acceleration from which a
+// jerk limited stop still fits in the remaining length; the last tick moves at most one commanded step
+// onto the end point. Every tick costs exactly two curve evaluations, a fixed number of stopping
+// distance checks, and never allocates, so its worst case execution time is bounded by the curve
+// degree only.
+class FeedRateInterpolator
+{
+public:
+    struct Setpoint
+    {
+        float u; // curve parameter
+        glm::vec3 position;
+        float feed; // commanded path speed
+        float acceleration; // commanded path acceleration
+        bool done; // end of the curve reached
+    };
+
+    /**
+     * @brief      Interpolator constructor
+     * @param[in]  curve            Curve to follow, must outlive the interpolator and stay unchanged
+     * @param[in]  period           Control period in seconds (e.g. 0.001 for 1 kHz)
+     * @param[in]  feed             Commanded path speed
+     * @param[in]  maxAcceleration  Path and centripetal acceleration limit
+     * @param[in]  maxJerk          Jerk limit
+     * @param[in]  lookAhead        Number of profile samples
+     */
+    FeedRateInterpolator(const BsplineCurve& curve,
+                         const float period,
+                         const float feed,
+                         const float maxAcceleration,
+                         const float maxJerk,
+                         const int lookAhead = 1024)
+        : m_curve(curve)
+        , m_period(period)
+        , m_feed(feed)
+        , m_maxAcceleration(maxAcceleration)
+        , m_maxJerk(maxJerk)
+        , m_lookAhead(max(lookAhead, 2))
+    {
+        plan();
+    }
+
+    // look-ahead: curvature limited speed profile over equally spaced arc length samples
+    void plan()
+    {
+        const vector<float>& knots = m_curve.GetKnots();
+        m_uStart = knots[m_curve.GetDegree()];
+        m_uEnd = knots[m_curve.GetControlPoints().size()];
+        m_length = m_curve.GetArcLength().length();
+        m_curve.EvaluateDerivatives(m_uEnd, 0, &m_endPoint, m_workspace);
+        m_step = m_length / (float)m_lookAhead;
+
+        vector<float> us;
+        m_curve.SampleByArcLength(m_lookAhead, us);
+        vector<glm::vec3> ders;
+        m_curve.EvaluateDerivatives(us, 2, ders);
+
+        // curvature limit: centripetal acceleration v^2 k <= A and jerk v^3 k^2 <= J
+        m_profile.resize(m_lookAhead + 1);
+        for (int i = 0; i <= m_lookAhead; i++)
+        {
+            float curvature = BasisCurve::Curvature(ders[3 * i + 1], ders[3 * i + 2]);
+            float limit = m_feed;
+            if (curvature > 0.0f)
+            {
+                limit = min(limit, sqrt(m_maxAcceleration / curvature));
+                limit = min(limit, cbrt(m_maxJerk / (curvature * curvature)));
+            }
+            m_profile[i] = limit;
+        }
+
+        // decelerate at half the limit so the jerk limited ramp in tick() still stops in time; the last
+        // sample is zero for the passes only, tick() brakes into the end with stoppingDistance()
+        const float braking = 0.5f * m_maxAcceleration;
+        m_profile[0] = 0.0f;
+        m_profile[m_lookAhead] = 0.0f;
+        for (int i = m_lookAhead - 1; i >= 0; i--)
+            m_profile[i] = min(m_profile[i], sqrt(m_profile[i + 1] * m_profile[i + 1] + 2.0f * braking * m_step));
+        for (int i = 1; i <= m_lookAhead; i++)
+            m_profile[i] = min(m_profile[i], sqrt(m_profile[i - 1] * m_profile[i - 1] + 2.0f * braking * m_step));
+
+        reset();
+    }
+
+    // back to the start of the curve, at rest
+    void reset()
+    {
+        m_u = m_uStart;
+        m_s = 0.0f;
+        m_speed = 0.0f;
+        m_acceleration = 0.0f;
+        m_carry = 0.0f;
+        m_final = -1.0f;
+        m_done = false;
+        m_curve.EvaluateDerivatives(m_u, 2, m_ders, m_workspace);
+    }
+
+    // advance one control period; no allocation, two curve evaluations
+    Setpoint tick()
+    {
+        if (m_done)
+            return {m_u, m_ders[0], 0.0f, 0.0f, true};
+
+        // length left: measured on the curve, and within the last sample the chord to the end point
+        // once, then counted down by the commanded steps; the steps there are close to the rounding
+        // of positions and of u, which would otherwise show up as noise in the braking
+        if (m_final < 0.0f && (m_length - m_s < m_step || m_u >= m_uEnd))
+            m_final = max(glm::length(m_endPoint - m_ders[0]) - m_carry, 0.0f);
+        const float remaining = m_final >= 0.0f ? m_final : max(m_length - m_s - m_carry, 0.0f);
+
+        // speed command: profile one sample ahead, acceleration and jerk limited
+        const int index = min((int)(m_s / m_step) + 1, m_lookAhead - 1);
+        const float gap = m_profile[index] - m_speed;
+        // leave room to ramp the acceleration back to zero, one jerk step at a time, before the target
+        // speed is reached: r^2 / (2 J) + 3/2 r T <= |gap|
+        const float jerkStep = m_maxJerk * m_period;
+        const float ramp = min(sqrt(2.25f * jerkStep * jerkStep + 2.0f * m_maxJerk * fabs(gap)) - 1.5f * jerkStep, m_maxAcceleration);
+        const float lowest = max(m_acceleration - jerkStep, -m_maxAcceleration);
+        const float highest = min(m_acceleration + jerkStep, m_maxAcceleration);
+        float acceleration = min(max(min(max(gap / m_period, -ramp), ramp), lowest), highest);
+
+        // end of the curve: the largest acceleration from which the rest of the curve is still enough
+        // to stop, bisected in a fixed number of steps
+        if (!canStop(remaining, acceleration))
+        {
+            float low = lowest, high = acceleration;
+            for (int i = 0; i < 16; i++)
+            {
+                const float middle = 0.5f * (low + high);
+                (canStop(remaining, middle) ? low : high) = middle;
+            }
+            acceleration = low;
+        }
+        const float speed = max(m_speed + acceleration * m_period, 0.0f);
+        m_acceleration = (speed - m_speed) / m_period;
+        m_speed = speed;
+        const float ds = speed * m_period;
+        const float step = ds + m_carry;
+        if (m_final >= 0.0f)
+            m_final = max(m_final - ds, 0.0f);
+
+        // predictor: u' = ds / |C'| - ds^2 (C' . C'') / (2 |C'|^4)
+        const glm::vec3 d1 = m_ders[1], d2 = m_ders[2];
+        const float speed2 = glm::dot(d1, d1);
+        float du = 0.0f;
+        if (speed2 > 0.0f)
+            du = step / sqrt(speed2) - step * step * glm::dot(d1, d2) / (2.0f * speed2 * speed2);
+
+        // corrector: scale the step so the chord matches the step length; not within the last sample,
+        // where the chord of such short steps is mostly rounding and the predictor is exact enough
+        if (du > 0.0f && m_final < 0.0f)
+        {
+            glm::vec3 predicted;
+            m_curve.EvaluateDerivatives(min(m_u + du, m_uEnd), 0, &predicted, m_workspace);
+            const float chord = glm::length(predicted - m_ders[0]);
+            if (chord > 0.0f)
+                du *= step / chord;
+        }
+
+        // the end is within this step, or the stop is reached: move onto it, at most ds (or the rounding
+        // of the countdown) away
+        if (remaining <= ds || (m_final >= 0.0f && speed <= 0.0f))
+        {
+            m_u = m_uEnd;
+            m_s = m_length;
+            m_done = true;
+            m_curve.EvaluateDerivatives(m_u, 2, m_ders, m_workspace);
+            return {m_u, m_ders[0], m_speed, m_acceleration, m_done};
+        }
+
+        // the part of the step lost to the rounding of u (slow, close to the end, where the steps are a
+        // few ulps of u) is carried over to the next tick, so it does not add up against the countdown
+        const float u = min(m_u + max(du, 0.0f), m_uEnd);
+        m_carry = du > 0.0f ? step * (1.0f - (u - m_u) / du) : step;
+        if (u == m_u)
+            return {m_u, m_ders[0], m_speed, m_acceleration, m_done};
+
+        const glm::vec3 previous = m_ders[0];
+        m_u = u;
+        m_curve.EvaluateDerivatives(m_u, 2, m_ders, m_workspace);
+        m_s += glm::length(m_ders[0] - previous); // travelled on the curve, not the commanded ds
+        return {m_u, m_ders[0], m_speed, m_acceleration, m_done};
+    }
+
+    // path length covered so far
+    float distance() const
+    {
+        return m_s;
+    }
+
+    float length() const
+    {
+        return m_length;
+    }
+
+    // planned speed limit at profile sample i, i in [0, lookAhead]
+    const vector<float>& profile() const
+    {
+        return m_profile;
+    }
+
+private:
+    const BsplineCurve& m_curve;
+    float m_period;
+    float m_feed;
+    float m_maxAcceleration;
+    float m_maxJerk;
+    int m_lookAhead;
+
+    float m_uStart = 0.0f, m_uEnd = 1.0f;
+    float m_length = 0.0f; // arc length
+    float m_step = 0.0f; // arc length between profile samples
+    glm::vec3 m_endPoint = glm::vec3(0.0f);
+    vector<float> m_profile; // speed limit per sample
+
+    // state
+    float m_u = 0.0f;
+    float m_s = 0.0f;
+    float m_speed = 0.0f;
+    float m_acceleration = 0.0f;
+    float m_carry = 0.0f; // commanded length not yet moved, below the resolution of u
+    float m_final = -1.0f; // length left within the last sample, negative before
+    bool m_done = false;
+    glm::vec3 m_ders[3]; // position, first and second derivative at m_u
+    BsplineCurve::DerivativeWorkspace m_workspace;
+
+    // accelerating by a for one period still leaves room to stop within the remaining length
+    bool canStop(const float remaining, const float a) const
+    {
+        const float v = m_speed + a * m_period;
+        return v <= 0.0f || stoppingDistance(v, a) <= remaining - v * m_period;
+    }
+
+    // length needed to come to rest from speed v and acceleration a: the deceleration ramps up to a
+    // peak (at most the acceleration limit), is held, and ramps back down to zero. Braking plans with
+    // a quarter of the jerk limit, the rest is headroom for the profile and the discrete ticks.
+    float stoppingDistance(const float v, const float a) const
+    {
+        const float J = 0.25f * m_maxJerk;
+        if (a < 0.0f && v <= 0.5f * a * a / J)
+        {
+            // at rest before the deceleration is back to zero: v + a t + J t^2 / 2 = 0
+            const float t = (-a - sqrt(max(a * a - 2.0f * J * v, 0.0f))) / J;
+            return v * t + 0.5f * a * t * t + J * t * t * t / 6.0f;
+        }
+        const float peak = min(sqrt(J * v + 0.5f * a * a), m_maxAcceleration);
+        if (peak <= 0.0f)
+            return 0.0f;
+        const float t1 = (a + peak) / J; // ramp to -peak
+        const float v1 = v + a * t1 - 0.5f * J * t1 * t1;
+        const float d1 = v * t1 + 0.5f * a * t1 * t1 - J * t1 * t1 * t1 / 6.0f;
+        const float t3 = peak / J; // ramp back to zero
+        const float t2 = max((v1 - 0.5f * peak * t3) / peak, 0.0f); // hold
+        const float v2 = v1 - peak * t2;
+        const float d2 = v1 * t2 - 0.5f * peak * t2 * t2;
+        const float d3 = v2 * t3 - 0.5f * peak * t3 * t3 + J * t3 * t3 * t3 / 6.0f;
+        return d1 + d2 + d3;
+    }
+};
+#endif
@@ -0,0 +1,628 @@
+#ifndef INTERSECTION_H
+#define INTERSECTION_H
+
+#include "segments.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// intersection of two curves, u0 on the first and u1 on the second curve
+struct CurveIntersection
+{
+    float u0, u1;
+    glm::vec3 point;
+    bool overlap = false; // start or end of a stretch where the curves coincide
+};
+
+// intersection of a curve with a ray origin + t * direction, t >= 0
+struct RayIntersection
+{
+    float u; // curve parameter
+    float t; // ray parameter
+    glm::vec3 point;
+    bool overlap = false; // start or end of a stretch where the curve runs along the ray
+};
+
+// Intersections of curves in Bezier form by recursive subdivision.
+// Pieces whose control polygon boxes (grown by the tolerance) do not overlap are rejected without
+// evaluating the curves, the others are halved with de Casteljau until both are flat within the
+// tolerance. Flat pieces are intersected as chords and the result is polished with Gauss-Newton on
+// the curves themselves.
+// Where the curves coincide over a stretch (or a curve runs along the ray) every pair of flat pieces
+// on it finds a hit. Consecutive hits between which the curves stay within the tolerance are merged,
+// so such a stretch is reported by its first and last hit only, both flagged as overlap.
+class CurveIntersector
+{
+public:
+    /**
+     * @brief      All intersections of two curves
+     * @param[in]  a          First curve
+     * @param[in]  b          Second curve
+     * @param[in]  tolerance  Distance below which the curves count as intersecting
+     * @param[out] out        Intersections are appended, sorted by the parameter on the first curve; a
+     *                        stretch where the curves coincide gives its two ends, flagged as overlap
+     */
+    void intersect(const BezierSegments& a, const BezierSegments& b, const float tolerance, vector<CurveIntersection>& out)
+    {
+        m_pool.clear();
+        m_pairs.clear();
+        const size_t first = out.size();
+        for (int i = 0; i < a.size(); i++)
+        {
+            for (int j = 0; j < b.size(); j++)
+            {
+                if (overlap(a.boundsMin(i), a.boundsMax(i), b.boundsMin(j), b.boundsMax(j), tolerance))
+                    m_pairs.push_back({wholePiece(a, i), wholePiece(b, j), 0});
+            }
+        }
+
+        while (!m_pairs.empty())
+        {
+            PiecePair pair = m_pairs.back();
+            m_pairs.pop_back();
+            if (!overlap(pair.a.bmin, pair.a.bmax, pair.b.bmin, pair.b.bmax, tolerance))
+                continue;
+
+            const bool flatA = pair.a.flatness <= tolerance, flatB = pair.b.flatness <= tolerance;
+            if ((flatA && flatB) || pair.depth >= maxDepth)
+            {
+                intersectChords(a, b, pair.a, pair.b, tolerance, out);
+                continue;
+            }
+
+            // halve the curvier piece, or the larger one when both are flat enough on their own
+            const bool splitA = flatB || (!flatA && glm::length(pair.a.bmax - pair.a.bmin) >= glm::length(pair.b.bmax - pair.b.bmin));
+            Piece left, right;
+            if (splitA)
+            {
+                halve(a.degree(), pair.a, left, right);
+                m_pairs.push_back({left, pair.b, pair.depth + 1});
+                m_pairs.push_back({right, pair.b, pair.depth + 1});
+            }
+            else
+            {
+                halve(b.degree(), pair.b, left, right);
+                m_pairs.push_back({pair.a, left, pair.depth + 1});
+                m_pairs.push_back({pair.a, right, pair.depth + 1});
+            }
+        }
+
+        // pieces sharing an end point report the same crossing twice
+        sort(out.begin() + first, out.end(), [](const CurveIntersection& l, const CurveIntersection& r) { return l.u0 < r.u0; });
+        size_t last = first;
+        for (size_t i = first; i < out.size(); i++)
+        {
+            if (last > first && glm::length(out[i].point - out[last - 1].point) <= tolerance)
+                continue;
+            out[last++] = out[i];
+        }
+        out.resize(last);
+        mergeOverlaps(out, first, [&a, &b, tolerance](const CurveIntersection& l, const CurveIntersection& r) {
+            for (int k = 1; k < overlapSamples; k++)
+            {
+                const float f = (float)k / overlapSamples;
+                const float u0 = l.u0 + f * (r.u0 - l.u0);
+                if (distanceNear(b, a.evaluate(u0), l.u1 + f * (r.u1 - l.u1)) > tolerance)
+                    return false;
+            }
+            return true;
+        });
+    }
+
+    /**
+     * @brief      All intersections of a curve with a ray
+     * @param[in]  a          Curve
+     * @param[in]  origin     Ray origin
+     * @param[in]  direction  Ray direction, not necessarily normalized
+     * @param[in]  tolerance  Distance below which the curve counts as hit
+     * @param[out] out        Intersections are appended, sorted by the curve parameter; a stretch along
+     *                        the ray gives its two ends, flagged as overlap
+     */
+    void intersectRay(const BezierSegments& a,
+                      const glm::vec3& origin,
+                      const glm::vec3& direction,
+                      const float tolerance,
+                      vector<RayIntersection>& out)
+    {
+        m_pool.clear();
+        m_pieces.clear();
+        const size_t first = out.size();
+        const float scale = glm::dot(direction, direction);
+        if (scale <= 0.0f)
+            return;
+
+        for (int i = 0; i < a.size(); i++)
+        {
+            if (rayHitsBox(origin, direction, a.boundsMin(i), a.boundsMax(i), tolerance))
+                m_pieces.push_back(wholePiece(a, i));
+        }
+        while (!m_pieces.empty())
+        {
+            Piece piece = m_pieces.back();
+            m_pieces.pop_back();
+            if (!rayHitsBox(origin, direction, piece.bmin, piece.bmax, tolerance))
+                continue;
+            if (piece.flatness <= tolerance || piece.depth >= maxDepth)
+            {
+                intersectChordRay(a, piece, origin, direction, tolerance, out);
+                continue;
+            }
+            Piece left, right;
+            halve(a.degree(), piece, left, right);
+            m_pieces.push_back(left);
+            m_pieces.push_back(right);
+        }
+
+        sort(out.begin() + first, out.end(), [](const RayIntersection& l, const RayIntersection& r) { return l.u < r.u; });
+        size_t last = first;
+        for (size_t i = first; i < out.size(); i++)
+        {
+            if (last > first && glm::length(out[i].point - out[last - 1].point) <= tolerance)
+                continue;
+            out[last++] = out[i];
+        }
+        out.resize(last);
+        const glm::vec3 axis = glm::normalize(direction);
+        mergeOverlaps(out, first, [&a, &origin, &axis, tolerance](const RayIntersection& l, const RayIntersection& r) {
+            for (int k = 1; k < overlapSamples; k++)
+            {
+                const glm::vec3 d = a.evaluate(l.u + (float)k / overlapSamples * (r.u - l.u)) - origin;
+                if (glm::dot(d, axis) < -tolerance || glm::length(d - axis * glm::dot(d, axis)) > tolerance)
+                    return false;
+            }
+            return true;
+        });
+    }
+
+    // closest points p1 + s d1 and p2 + t d2 with s in [0, 1] and t in [0, tMax] (Ericson, RTCD 5.1.9)
+    static void closestPoints(const glm::vec3& p1,
+                              const glm::vec3& d1,
+                              const glm::vec3& p2,
+                              const glm::vec3& d2,
+                              const float tMax,
+                              float& s,
+                              float& t)
+    {
+        const glm::vec3 r = p1 - p2;
+        const float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+        const float eps = 1e-12f;
+        if (a <= eps && e <= eps)
+        {
+            s = t = 0.0f;
+            return;
+        }
+        if (a <= eps)
+        {
+            s = 0.0f;
+            t = min(max(f / e, 0.0f), tMax);
+            return;
+        }
+        const float c = glm::dot(d1, r);
+        if (e <= eps)
+        {
+            t = 0.0f;
+            s = min(max(-c / a, 0.0f), 1.0f);
+            return;
+        }
+        const float b = glm::dot(d1, d2);
+        const float denom = a * e - b * b;
+        s = denom > 0.0f ? min(max((b * f - c * e) / denom, 0.0f), 1.0f) : 0.0f;
+        t = (b * s + f) / e;
+        if (t < 0.0f)
+        {
+            t = 0.0f;
+            s = min(max(-c / a, 0.0f), 1.0f);
+        }
+        else if (t > tMax)
+        {
+            t = tMax;
+            s = min(max((b * tMax - c) / a, 0.0f), 1.0f);
+        }
+    }
+
+    // boxes grown by the tolerance overlap
+    static bool overlap(const glm::vec3& minA, const glm::vec3& maxA, const glm::vec3& minB, const glm::vec3& maxB, const float tolerance)
+    {
+        return minA.x <= maxB.x + tolerance && minB.x <= maxA.x + tolerance && minA.y <= maxB.y + tolerance &&
+               minB.y <= maxA.y + tolerance && minA.z <= maxB.z + tolerance && minB.z <= maxA.z + tolerance;
+    }
+
+    // slab test of the ray t >= 0 against the box grown by the tolerance
+    static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& bmin, const glm::vec3& bmax, const float tolerance)
+    {
+        float t0 = 0.0f, t1 = FLT_MAX;
+        for (int k = 0; k < 3; k++)
+        {
+            const float lo = bmin[k] - tolerance, hi = bmax[k] + tolerance;
+            if (direction[k] == 0.0f)
+            {
+                if (origin[k] < lo || origin[k] > hi)
+                    return false;
+                continue;
+            }
+            float enter = (lo - origin[k]) / direction[k], leave = (hi - origin[k]) / direction[k];
+            if (enter > leave)
+                swap(enter, leave);
+            t0 = max(t0, enter);
+            t1 = min(t1, leave);
+            if (t0 > t1)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    static const int maxDepth = 40; // subdivision limit, reached by overlapping or tangent curves only
+    static const int overlapSamples = 4; // intervals checked between two hits for a coinciding stretch
+
+    // part [t0, t1] of a segment, control points in the pool
+    struct Piece
+    {
+        int segment;
+        float t0, t1;
+        int offset; // first control point in m_pool
+        int depth;
+        glm::vec3 bmin, bmax;
+        float flatness;
+    };
+
+    struct PiecePair
+    {
+        Piece a, b;
+        int depth;
+    };
+
+    vector<glm::vec4> m_pool; // control points of all pieces of the current query
+    vector<PiecePair> m_pairs;
+    vector<Piece> m_pieces;
+
+    // runs of consecutive hits (sorted, from first on) that coincide pairwise are replaced by their
+    // first and last hit, flagged as overlap
+    template <class Intersection, class Coincide>
+    static void mergeOverlaps(vector<Intersection>& out, const size_t first, Coincide coincide)
+    {
+        size_t last = first;
+        for (size_t i = first; i < out.size();)
+        {
+            size_t j = i;
+            while (j + 1 < out.size() && coincide(out[j], out[j + 1]))
+                j++;
+            out[last++] = out[i];
+            if (j > i)
+            {
+                out[last - 1].overlap = true;
+                out[last] = out[j];
+                out[last++].overlap = true;
+            }
+            i = j + 1;
+        }
+        out.resize(last);
+    }
+
+    // distance of point from the curve near parameter u, with a few Newton steps on the segment of u
+    static float distanceNear(const BezierSegments& segments, const glm::vec3& point, const float u)
+    {
+        const int i = segments.find(u);
+        const float length = segments.end(i) - segments.start(i);
+        float t = length > 0.0f ? min(max((u - segments.start(i)) / length, 0.0f), 1.0f) : 0.0f;
+        glm::vec3 ders[3];
+        for (int iteration = 0; iteration < 4; iteration++)
+        {
+            segments.evaluateSegmentDerivatives(i, t, ders);
+            const glm::vec3 d = ders[0] - point;
+            const float df = glm::dot(ders[2], d) + glm::dot(ders[1], ders[1]);
+            if (df <= 0.0f)
+                break;
+            t = min(max(t - glm::dot(ders[1], d) / df, 0.0f), 1.0f);
+        }
+        return glm::length(segments.evaluateSegment(i, t) - point);
+    }
+
+    Piece wholePiece(const BezierSegments& segments, const int i)
+    {
+        const int order = segments.degree() + 1;
+        Piece piece = {i, 0.0f, 1.0f, (int)m_pool.size(), 0, segments.boundsMin(i), segments.boundsMax(i), segments.flatness(i)};
+        m_pool.insert(m_pool.end(), segments.points(i), segments.points(i) + order);
+        return piece;
+    }
+
+    void halve(const int p, const Piece& piece, Piece& left, Piece& right)
+    {
+        const int order = p + 1;
+        const int offset = m_pool.size();
+        m_pool.resize(offset + 3 * order);
+        copy(m_pool.begin() + piece.offset, m_pool.begin() + piece.offset + order, m_pool.begin() + offset + 2 * order);
+        BezierSegments::halve(&m_pool[offset + 2 * order], p, &m_pool[offset], &m_pool[offset + order]);
+        m_pool.resize(offset + 2 * order);
+
+        const float mid = 0.5f * (piece.t0 + piece.t1);
+        left = {piece.segment, piece.t0, mid, offset, piece.depth + 1, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+        right = {piece.segment, mid, piece.t1, offset + order, piece.depth + 1, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+        left.flatness = BezierSegments::hull(&m_pool[left.offset], p, left.bmin, left.bmax);
+        right.flatness = BezierSegments::hull(&m_pool[right.offset], p, right.bmin, right.bmax);
+    }
+
+    glm::vec3 chordStart(const Piece& piece) const
+    {
+        return glm::vec3(m_pool[piece.offset]) / m_pool[piece.offset].w;
+    }
+
+    glm::vec3 chordEnd(const int p, const Piece& piece) const
+    {
+        return glm::vec3(m_pool[piece.offset + p]) / m_pool[piece.offset + p].w;
+    }
+
+    void intersectChords(const BezierSegments& a,
+                         const BezierSegments& b,
+                         const Piece& pieceA,
+                         const Piece& pieceB,
+                         const float tolerance,
+                         vector<CurveIntersection>& out) const
+    {
+        const glm::vec3 a0 = chordStart(pieceA), a1 = chordEnd(a.degree(), pieceA);
+        const glm::vec3 b0 = chordStart(pieceB), b1 = chordEnd(b.degree(), pieceB);
+        float s, t;
+        closestPoints(a0, a1 - a0, b0, b1 - b0, 1.0f, s, t);
+        const float slack = pieceA.flatness + pieceB.flatness + tolerance;
+        if (glm::length(a0 + s * (a1 - a0) - b0 - t * (b1 - b0)) > slack)
+            return;
+
+        // chords running along each other: polish both ends of their common part, so that a stretch
+        // where the curves coincide is found up to its ends
+        float s0, s1;
+        if (commonPart(a0, a1 - a0, b0, b1 - b0, 1.0f, slack, s0, s1))
+        {
+            for (const float end : {s0, s1})
+            {
+                t = glm::dot(a0 + end * (a1 - a0) - b0, b1 - b0) / glm::dot(b1 - b0, b1 - b0);
+                polishCurves(a, b, pieceA, pieceB, end, min(max(t, 0.0f), 1.0f), tolerance, out);
+            }
+            return;
+        }
+        polishCurves(a, b, pieceA, pieceB, s, t, tolerance, out);
+    }
+
+    // part [s0, s1] of the chord p1 + s d1 that runs along the segment p2 + t d2, t in [0, tMax], when both
+    // chord ends lie within slack of the line through the segment
+    static bool commonPart(const glm::vec3& p1,
+                           const glm::vec3& d1,
+                           const glm::vec3& p2,
+                           const glm::vec3& d2,
+                           const float tMax,
+                           const float slack,
+                           float& s0,
+                           float& s1)
+    {
+        const float e = glm::dot(d2, d2);
+        if (e <= 0.0f)
+            return false;
+        const float t0 = glm::dot(p1 - p2, d2) / e, t1 = glm::dot(p1 + d1 - p2, d2) / e;
+        if (t0 == t1 || glm::length(p1 - p2 - t0 * d2) > slack || glm::length(p1 + d1 - p2 - t1 * d2) > slack)
+            return false;
+        const float lo = max(min(t0, t1), 0.0f), hi = min(max(t0, t1), tMax);
+        if (lo > hi)
+            return false;
+        s0 = (lo - t0) / (t1 - t0);
+        s1 = (hi - t0) / (t1 - t0);
+        if (s0 > s1)
+            swap(s0, s1);
+        return true;
+    }
+
+    // Gauss-Newton on |A(s) - B(t)|^2 over the local parameters of the two segments, from the chord
+    // parameters s, t of the two pieces
+    static void polishCurves(const BezierSegments& a,
+                             const BezierSegments& b,
+                             const Piece& pieceA,
+                             const Piece& pieceB,
+                             float s,
+                             float t,
+                             const float tolerance,
+                             vector<CurveIntersection>& out)
+    {
+        s = pieceA.t0 + s * (pieceA.t1 - pieceA.t0);
+        t = pieceB.t0 + t * (pieceB.t1 - pieceB.t0);
+        glm::vec3 dersA[3], dersB[3];
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            a.evaluateSegmentDerivatives(pieceA.segment, s, dersA);
+            b.evaluateSegmentDerivatives(pieceB.segment, t, dersB);
+            const glm::vec3 r = dersA[0] - dersB[0];
+            const float aa = glm::dot(dersA[1], dersA[1]), ab = -glm::dot(dersA[1], dersB[1]), bb = glm::dot(dersB[1], dersB[1]);
+            const float ga = -glm::dot(dersA[1], r), gb = glm::dot(dersB[1], r);
+            const float det = aa * bb - ab * ab;
+            if (det <= 1e-12f * aa * bb)
+                break; // tangent curves, keep the chord estimate
+            const float ds = (ga * bb - ab * gb) / det, dt = (aa * gb - ab * ga) / det;
+            s = min(max(s + ds, 0.0f), 1.0f);
+            t = min(max(t + dt, 0.0f), 1.0f);
+            if (fabs(ds) < 1e-7f && fabs(dt) < 1e-7f)
+                break;
+        }
+
+        const glm::vec3 pointA = a.evaluateSegment(pieceA.segment, s), pointB = b.evaluateSegment(pieceB.segment, t);
+        if (glm::length(pointA - pointB) > tolerance)
+            return;
+        const float u0 = a.start(pieceA.segment) + s * (a.end(pieceA.segment) - a.start(pieceA.segment));
+        const float u1 = b.start(pieceB.segment) + t * (b.end(pieceB.segment) - b.start(pieceB.segment));
+        out.push_back({u0, u1, 0.5f * (pointA + pointB)});
+    }
+
+    void intersectChordRay(const BezierSegments& a,
+                           const Piece& piece,
+                           const glm::vec3& origin,
+                           const glm::vec3& direction,
+                           const float tolerance,
+                           vector<RayIntersection>& out) const
+    {
+        const glm::vec3 a0 = chordStart(piece), a1 = chordEnd(a.degree(), piece);
+        float s, t;
+        closestPoints(a0, a1 - a0, origin, direction, FLT_MAX, s, t);
+        const float slack = piece.flatness + tolerance;
+        if (glm::length(a0 + s * (a1 - a0) - origin - t * direction) > slack)
+            return;
+
+        // a chord along the ray: polish both ends of the part in front of the origin
+        float s0, s1;
+        if (commonPart(a0, a1 - a0, origin, direction, FLT_MAX, slack, s0, s1))
+        {
+            polishRay(a, piece, origin, direction, s0, tolerance, out);
+            polishRay(a, piece, origin, direction, s1, tolerance, out);
+            return;
+        }
+        polishRay(a, piece, origin, direction, s, tolerance, out);
+    }
+
+    static void polishRay(const BezierSegments& a,
+                          const Piece& piece,
+                          const glm::vec3& origin,
+                          const glm::vec3& direction,
+                          float s,
+                          const float tolerance,
+                          vector<RayIntersection>& out)
+    {
+        // Newton on the squared distance of C(s) from the ray line, components across the ray only
+        const glm::vec3 axis = glm::normalize(direction);
+        auto across = [&axis](const glm::vec3& v) { return v - axis * glm::dot(v, axis); };
+        s = piece.t0 + s * (piece.t1 - piece.t0);
+        glm::vec3 ders[3];
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            a.evaluateSegmentDerivatives(piece.segment, s, ders);
+            const glm::vec3 d = across(ders[0] - origin), d1 = across(ders[1]);
+            const float f = glm::dot(d1, d);
+            const float df = glm::dot(across(ders[2]), d) + glm::dot(d1, d1);
+            if (df <= 0.0f)
+                break;
+            const float step = f / df;
+            s = min(max(s - step, 0.0f), 1.0f);
+            if (fabs(step) < 1e-7f)
+                break;
+        }
+
+        const glm::vec3 point = a.evaluateSegment(piece.segment, s);
+        const float t = glm::dot(point - origin, direction) / glm::dot(direction, direction);
+        if (t < 0.0f || glm::length(across(point - origin)) > tolerance)
+            return;
+        const float u = a.start(piece.segment) + s * (a.end(piece.segment) - a.start(piece.segment));
+        out.push_back({u, t, point});
+    }
+};
+
+// Broad phase for many curves: sweep and prune over the curve bounding boxes along x, so pairs of
+// curves whose boxes do not overlap are rejected without looking at their segments.
+class CurveBoxIndex
+{
+public:
+    struct Hit
+    {
+        int first, second; // curve ids, first < second
+        CurveIntersection intersection;
+    };
+
+    void clear()
+    {
+        m_curves.clear();
+        m_boundsMin.clear();
+        m_boundsMax.clear();
+    }
+
+    // add a curve (copied), returns its id
+    int add(const BezierSegments& segments)
+    {
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+        for (int i = 0; i < segments.size(); i++)
+        {
+            lo = glm::min(lo, segments.boundsMin(i));
+            hi = glm::max(hi, segments.boundsMax(i));
+        }
+        m_curves.push_back(segments);
+        m_boundsMin.push_back(lo);
+        m_boundsMax.push_back(hi);
+        return m_curves.size() - 1;
+    }
+
+    int size() const
+    {
+        return m_curves.size();
+    }
+
+    const BezierSegments& curve(const int id) const
+    {
+        return m_curves[id];
+    }
+
+    // pairs of curves whose boxes grown by the tolerance overlap
+    void candidates(const float tolerance, vector<pair<int, int>>& pairs) const
+    {
+        pairs.clear();
+        vector<int> order(m_curves.size());
+        for (int i = 0; i < (int)order.size(); i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [this](int l, int r) { return m_boundsMin[l].x < m_boundsMin[r].x; });
+
+        vector<int> active;
+        for (int id : order)
+        {
+            // drop the curves that end before this one starts along x
+            size_t kept = 0;
+            for (size_t k = 0; k < active.size(); k++)
+            {
+                if (m_boundsMax[active[k]].x + tolerance >= m_boundsMin[id].x)
+                    active[kept++] = active[k];
+            }
+            active.resize(kept);
+            for (int other : active)
+            {
+                if (CurveIntersector::overlap(m_boundsMin[id], m_boundsMax[id], m_boundsMin[other], m_boundsMax[other], tolerance))
+                    pairs.push_back({min(id, other), max(id, other)});
+            }
+            active.push_back(id);
+        }
+    }
+
+    // intersections between all pairs of curves
+    void intersectAll(const float tolerance, vector<Hit>& hits) const
+    {
+        hits.clear();
+        vector<pair<int, int>> pairs;
+        candidates(tolerance, pairs);
+        CurveIntersector intersector;
+        vector<CurveIntersection> found;
+        for (const pair<int, int>& candidate : pairs)
+        {
+            found.clear();
+            intersector.intersect(m_curves[candidate.first], m_curves[candidate.second], tolerance, found);
+            for (const CurveIntersection& intersection : found)
+                hits.push_back({candidate.first, candidate.second, intersection});
+        }
+    }
+
+    // curves hit by a ray, as (curve id, intersection)
+    void intersectRay(const glm::vec3& origin, const glm::vec3& direction, const float tolerance, vector<pair<int, RayIntersection>>& hits) const
+    {
+        hits.clear();
+        CurveIntersector intersector;
+        vector<RayIntersection> found;
+        for (int id = 0; id < (int)m_curves.size(); id++)
+        {
+            if (!CurveIntersector::rayHitsBox(origin, direction, m_boundsMin[id], m_boundsMax[id], tolerance))
+                continue;
+            found.clear();
+            intersector.intersectRay(m_curves[id], origin, direction, tolerance, found);
+            for (const RayIntersection& intersection : found)
+                hits.push_back({id, intersection});
+        }
+    }
+
+private:
+    vector<BezierSegments> m_curves;
+    vector<glm::vec3> m_boundsMin; // box of every curve
+    vector<glm::vec3> m_boundsMax;
+};
+#endif
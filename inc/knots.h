@@ -0,0 +1,228 @@
+#ifndef KNOTS_H
+#define KNOTS_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Knots array of a degree p B-spline together with the tables derived from it.
+//
+// Immutable once built. intern() hands out one shared instance per distinct (p, knots), keyed by a hash of
+// the content, so curves built from the same template share the knots and every precomputed table instead
+// of copying them. The registry holds weak references only: tables are freed with their last curve.
+struct KnotTables
+{
+    int p;
+    vector<float> knots;
+
+    // 1 / (knots[k + i] - knots[k]) at (i - 1) * knots.size() + k for the degrees i = 1 .. p, 0 for empty
+    // or missing differences so that Cox-de Boor needs neither divisions nor zero checks
+    vector<float> reciprocals;
+
+    // uniform spans share one basis matrix: N_{span - p + r}(t) = sum_k uniformBasis[r * (p + 1) + k] t^k
+    // with t in [0, 1) across the span
+    vector<char> uniformSpan; // per knot span index
+    bool hasUniformSpans = false;
+    bool uniformKnots = false; // all knots equally spaced (unclamped uniform B-spline)
+    vector<float> uniformBasis;
+    vector<float> differenceBasis; // j! S(k, j): forward differences of s^k at s = 0
+
+    // the shared tables of knots and degree p, built on first request
+    static shared_ptr<const KnotTables> intern(const vector<float>& knots, const int p)
+    {
+        return internImpl(knots, p);
+    }
+
+    // same, a new entry takes over the knots array instead of copying it
+    static shared_ptr<const KnotTables> intern(vector<float>&& knots, const int p)
+    {
+        return internImpl(knots, p);
+    }
+
+    // number of distinct tables alive
+    static size_t internedCount()
+    {
+        Registry& registry = getRegistry();
+        lock_guard<mutex> lock(registry.lock);
+        size_t count = 0;
+        for (const auto& bucket : registry.tables)
+            for (const weak_ptr<const KnotTables>& tables : bucket.second)
+                count += !tables.expired();
+        return count;
+    }
+
+    // builds the tables, use intern() to share them
+    KnotTables(vector<float> knots, const int p)
+        : p(p), knots(move(knots))
+    {
+        buildReciprocals();
+        buildUniformSpans();
+    }
+
+private:
+    struct Registry
+    {
+        mutex lock;
+        unordered_map<size_t, vector<weak_ptr<const KnotTables>>> tables;
+    };
+
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // Knots is const vector<float> (copied into a new entry) or vector<float> (moved)
+    template <typename Knots>
+    static shared_ptr<const KnotTables> internImpl(Knots& knots, const int p)
+    {
+        const size_t key = hash(knots, p);
+        Registry& registry = getRegistry();
+        lock_guard<mutex> lock(registry.lock);
+        vector<weak_ptr<const KnotTables>>& bucket = registry.tables[key];
+        for (size_t i = 0; i < bucket.size();)
+        {
+            shared_ptr<const KnotTables> tables = bucket[i].lock();
+            if (!tables)
+            {
+                bucket[i] = bucket.back(); // freed, drop the entry
+                bucket.pop_back();
+                continue;
+            }
+            if (tables->p == p && tables->knots == knots)
+                return tables;
+            i++;
+        }
+        shared_ptr<KnotTables> tables = make_shared<KnotTables>(move(knots), p);
+        bucket.push_back(tables);
+        return tables;
+    }
+
+    // FNV-1a over the degree and the bits of the knots
+    static size_t hash(const vector<float>& knots, const int p)
+    {
+        uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](const uint32_t bits) {
+            h ^= bits;
+            h *= 1099511628211ull;
+        };
+        mix((uint32_t)p);
+        for (const float knot : knots)
+        {
+            uint32_t bits;
+            memcpy(&bits, &knot, sizeof(bits));
+            mix(bits);
+        }
+        return (size_t)h;
+    }
+
+    void buildReciprocals()
+    {
+        const int m = knots.size();
+        reciprocals.assign(p * m, 0.0f);
+        for (int i = 1; i <= p; i++)
+        {
+            for (int k = 0; k + i < m; k++)
+            {
+                const float difference = knots[k + i] - knots[k];
+                if (difference > 0.0f)
+                    reciprocals[(i - 1) * m + k] = 1.0f / difference;
+            }
+        }
+    }
+
+    // mark the spans whose 2p surrounding knots are equally spaced
+    void buildUniformSpans()
+    {
+        const int n = (int)knots.size() - p - 2;
+        uniformSpan.assign(knots.size(), 0);
+        hasUniformSpans = false;
+        for (int span = p; span <= n; span++)
+        {
+            const float h = knots[span + 1] - knots[span];
+            bool uniform = h > 0.0f;
+            for (int i = span - p + 1; uniform && i < span + p; i++)
+                uniform = sameSpacing(i, h);
+            uniformSpan[span] = uniform;
+            hasUniformSpans = hasUniformSpans || uniform;
+        }
+
+        // the whole knots array equally spaced, required by subdivision
+        uniformKnots = knots.size() >= 2 && knots[1] > knots[0];
+        for (int i = 1; uniformKnots && i + 1 < (int)knots.size(); i++)
+            uniformKnots = sameSpacing(i, knots[1] - knots[0]);
+        if (!hasUniformSpans)
+            return;
+        uniformBasisMatrix(p, uniformBasis);
+
+        // j! S(k, j) from S(k, j) = j S(k - 1, j) + S(k - 1, j - 1)
+        const int order = p + 1;
+        differenceBasis.assign(order * order, 0.0f);
+        vector<double> S(order * order, 0.0);
+        S[0] = 1.0;
+        for (int k = 1; k <= p; k++)
+            for (int j = 1; j <= k; j++)
+                S[k * order + j] = (double)j * S[(k - 1) * order + j] + S[(k - 1) * order + j - 1];
+        for (int k = 0; k <= p; k++)
+        {
+            double factorial = 1.0;
+            for (int j = 0; j <= k; j++)
+            {
+                if (j > 0)
+                    factorial *= (double)j;
+                differenceBasis[k * order + j] = (float)(factorial * S[k * order + j]);
+            }
+        }
+    }
+
+    // knot interval i has length h up to the rounding of the knot values
+    bool sameSpacing(const int i, const float h) const
+    {
+        const float magnitude = max(fabs(knots[i]), fabs(knots[i + 1]));
+        return fabs((knots[i + 1] - knots[i]) - h) <= 1e-5f * h + 8.0f * FLT_EPSILON * magnitude;
+    }
+
+    // Cox-de Boor recursion on polynomials over the integer knots 0 .. 2p + 1, span [p, p + 1)
+    static void uniformBasisMatrix(const int p, vector<float>& M)
+    {
+        const int order = p + 1;
+        // N[i * order + k]: coefficient of t^k of N_{i, degree}, t = x - p
+        vector<double> N(order * order, 0.0), next(order * order);
+        N[p * order] = 1.0;
+        for (int degree = 1; degree <= p; degree++)
+        {
+            fill(next.begin(), next.end(), 0.0);
+            for (int i = p - degree; i <= p; i++)
+            {
+                // (x - i) / degree * N_{i, degree - 1} + (i + degree + 1 - x) / degree * N_{i + 1, degree - 1}
+                for (int k = 0; k < degree; k++)
+                {
+                    if (i > p - degree)
+                    {
+                        const double c = N[i * order + k] / degree;
+                        next[i * order + k] += (double)(p - i) * c;
+                        next[i * order + k + 1] += c;
+                    }
+                    if (i < p)
+                    {
+                        const double c = N[(i + 1) * order + k] / degree;
+                        next[i * order + k] += (double)(i + degree + 1 - p) * c;
+                        next[i * order + k + 1] -= c;
+                    }
+                }
+            }
+            N.swap(next);
+        }
+        M.resize(order * order);
+        for (int i = 0; i < order * order; i++)
+            M[i] = (float)N[i];
+    }
+};
+#endif
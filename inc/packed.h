@@ -0,0 +1,85 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// Vertices quantized to unsigned integers T per coordinate over their bounding box; 16 bits are half the
+// size of glm::vec3.
+//
+// The error is at most half a step, extent / max / 2 per axis with max the largest T, far below a pixel for
+// any curve that fits on screen at 16 bits. Lossy: unpacking does not give back the exact floats, so
+// derived data that needs them (arc length, projection) evaluates the curve instead. The values are also
+// the layout of a normalized integer vertex attribute: origin + aPos * extent() restores the vertex.
+template <typename T>
+struct PackedVerticesT
+{
+    static constexpr float steps = (float)numeric_limits<T>::max();
+
+    glm::vec3 origin = glm::vec3(0.0f); // bounding box minimum
+    glm::vec3 scale = glm::vec3(0.0f); // extent / steps per axis
+    vector<glm::vec<3, T>> values;
+
+    // largest quantization error of vertices with the given bounding box extent
+    static float error(const glm::vec3& extent)
+    {
+        return max(max(extent.x, extent.y), extent.z) / steps * 0.5f;
+    }
+
+    void pack(const vector<glm::vec3>& vertices)
+    {
+        values.resize(vertices.size());
+        if (vertices.empty())
+            return;
+        glm::vec3 lo = vertices[0], hi = vertices[0];
+        for (const glm::vec3& v : vertices)
+        {
+            lo = glm::min(lo, v);
+            hi = glm::max(hi, v);
+        }
+        origin = lo;
+        scale = (hi - lo) / steps;
+
+        // flat axes map to 0
+        glm::vec3 inverse;
+        for (int axis = 0; axis < 3; axis++)
+            inverse[axis] = scale[axis] > 0.0f ? 1.0f / scale[axis] : 0.0f;
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const glm::vec3 q = glm::clamp((vertices[i] - origin) * inverse + 0.5f, glm::vec3(0.0f), glm::vec3(steps));
+            values[i] = glm::vec<3, T>(q);
+        }
+    }
+
+    void unpack(vector<glm::vec3>& vertices) const
+    {
+        vertices.resize(values.size());
+        for (size_t i = 0; i < values.size(); i++)
+            vertices[i] = origin + glm::vec3(values[i]) * scale;
+    }
+
+    void clear()
+    {
+        values.clear();
+        values.shrink_to_fit();
+    }
+
+    size_t size() const
+    {
+        return values.size();
+    }
+
+    // bounding box extent, the dequantization scale of a normalized attribute
+    glm::vec3 extent() const
+    {
+        return scale * steps;
+    }
+};
+
+using PackedVertices = PackedVerticesT<uint16_t>;
+#endif
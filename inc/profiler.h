@@ -0,0 +1,264 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifndef BSPLINE_NO_GL
+#include <glad/glad.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Per-frame phase profiler.
+// Compiled in only when BSPLINE_PROFILE is defined, otherwise every PROFILE_* macro expands to nothing.
+// CPU phases are timed with steady_clock, GPU phases with GL_TIME_ELAPSED queries (GL 3.3+).
+// GPU results are collected a few frames late so that reading them never stalls the pipeline.
+// With BSPLINE_NO_GL the GPU scopes degrade to CPU scopes.
+
+class Profiler
+{
+public:
+    struct Event
+    {
+        const char* name;
+        double start; // microseconds since profiler creation
+        double duration; // microseconds
+        bool gpu;
+    };
+
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // microseconds since profiler creation
+    double now() const
+    {
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - m_origin).count();
+    }
+
+    void beginFrame()
+    {
+        m_frameStart = now();
+#ifndef BSPLINE_NO_GL
+        m_gpuAvailable = GLAD_GL_VERSION_3_3 != 0;
+#endif
+    }
+
+    void endFrame()
+    {
+        record("Frame", m_frameStart, now() - m_frameStart, false);
+#ifndef BSPLINE_NO_GL
+        collectGpuQueries();
+#endif
+    }
+
+    void record(const char* name, const double start, const double duration, const bool gpu)
+    {
+        if (m_events.size() < m_maxEvents)
+            m_events.push_back({name, start, duration, gpu});
+
+        Stat& stat = findStat(name, gpu);
+        stat.total += duration;
+        stat.count++;
+    }
+
+#ifndef BSPLINE_NO_GL
+    // returns 0 if timer queries are unsupported or another GPU scope is already open
+    unsigned int beginGpuQuery()
+    {
+        if (!m_gpuAvailable || m_gpuQueryOpen)
+            return 0;
+
+        unsigned int query;
+        if (m_freeQueries.empty())
+        {
+            glGenQueries(1, &query);
+        }
+        else
+        {
+            query = m_freeQueries.back();
+            m_freeQueries.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        m_gpuQueryOpen = true;
+        return query;
+    }
+
+    void endGpuQuery(const unsigned int query, const char* name, const double cpuStart)
+    {
+        if (query == 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        m_gpuQueryOpen = false;
+        m_pendingQueries.push_back({query, name, cpuStart});
+    }
+#endif
+
+    // one line summary of average phase times since the last call, e.g. for the window title
+    string summary()
+    {
+        string text;
+        char buffer[64];
+        for (Stat& stat : m_stats)
+        {
+            if (stat.count == 0)
+                continue;
+            snprintf(buffer, sizeof(buffer), "%s%s %.3fms  ", stat.name, stat.gpu ? "(gpu)" : "",
+                     stat.total / stat.count / 1000.0);
+            text += buffer;
+            stat.total = 0.0;
+            stat.count = 0;
+        }
+        return text;
+    }
+
+    // write all recorded events as a Chrome trace (chrome://tracing or https://ui.perfetto.dev)
+    bool writeChromeTrace(const string& path) const
+    {
+        FILE* file = fopen(path.c_str(), "w");
+        if (!file)
+            return false;
+
+        fprintf(file, "{\"traceEvents\":[\n");
+        for (size_t i = 0; i < m_events.size(); i++)
+        {
+            const Event& event = m_events[i];
+            fprintf(file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d}%s\n",
+                    event.name, event.gpu ? "gpu" : "cpu", event.start, event.duration, event.gpu ? 1 : 0,
+                    i + 1 < m_events.size() ? "," : "");
+        }
+        fprintf(file, "],\n\"displayTimeUnit\":\"ms\"}\n");
+        fclose(file);
+        return true;
+    }
+
+private:
+    struct Stat
+    {
+        const char* name;
+        bool gpu;
+        double total;
+        int count;
+    };
+
+    struct PendingQuery
+    {
+        unsigned int query;
+        const char* name;
+        double cpuStart;
+    };
+
+    chrono::steady_clock::time_point m_origin = chrono::steady_clock::now();
+    vector<Event> m_events;
+    vector<Stat> m_stats;
+    vector<PendingQuery> m_pendingQueries;
+    vector<unsigned int> m_freeQueries;
+    size_t m_maxEvents = 1 << 20; // bound the trace so long sessions do not grow without limit
+    double m_frameStart = 0.0;
+    bool m_gpuAvailable = false;
+    bool m_gpuQueryOpen = false;
+
+    Profiler() = default;
+
+    Stat& findStat(const char* name, const bool gpu)
+    {
+        for (Stat& stat : m_stats)
+        {
+            if (stat.gpu == gpu && strcmp(stat.name, name) == 0)
+                return stat;
+        }
+        m_stats.push_back({name, gpu, 0.0, 0});
+        return m_stats.back();
+    }
+
+#ifndef BSPLINE_NO_GL
+    // move finished queries into the event list without waiting on the ones still in flight
+    void collectGpuQueries()
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < m_pendingQueries.size(); i++)
+        {
+            PendingQuery& pending = m_pendingQueries[i];
+            GLint available = 0;
+            glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                m_pendingQueries[kept++] = pending;
+                continue;
+            }
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+            record(pending.name, pending.cpuStart, elapsed / 1000.0, true);
+            m_freeQueries.push_back(pending.query);
+        }
+        m_pendingQueries.resize(kept);
+    }
+#endif
+};
+
+// times the enclosing scope on the CPU
+class CpuProfileScope
+{
+public:
+    explicit CpuProfileScope(const char* name) : m_name(name), m_start(Profiler::instance().now())
+    {
+    }
+
+    ~CpuProfileScope()
+    {
+        Profiler& profiler = Profiler::instance();
+        profiler.record(m_name, m_start, profiler.now() - m_start, false);
+    }
+
+private:
+    const char* m_name;
+    double m_start;
+};
+
+#ifndef BSPLINE_NO_GL
+// times the enclosing scope on the CPU and, when no other GPU scope is open, on the GPU
+class GpuProfileScope
+{
+public:
+    explicit GpuProfileScope(const char* name)
+        : m_cpu(name), m_name(name), m_start(Profiler::instance().now()), m_query(Profiler::instance().beginGpuQuery())
+    {
+    }
+
+    ~GpuProfileScope()
+    {
+        Profiler::instance().endGpuQuery(m_query, m_name, m_start);
+    }
+
+private:
+    CpuProfileScope m_cpu;
+    const char* m_name;
+    double m_start;
+    unsigned int m_query;
+};
+#else
+typedef CpuProfileScope GpuProfileScope;
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef BSPLINE_PROFILE
+#define PROFILE_BEGIN_FRAME() Profiler::instance().beginFrame()
+#define PROFILE_END_FRAME() Profiler::instance().endFrame()
+#define PROFILE_CPU_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_END_FRAME()
+#define PROFILE_CPU_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#endif
+
+#endif
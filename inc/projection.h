@@ -0,0 +1,285 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include "segments.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Closest point queries against a curve in Bezier form.
+// Every Bezier segment is split with de Casteljau until its control polygon is flat, the boxes of
+// these pieces form the leaves of a bounding volume hierarchy. A query descends the hierarchy nearest
+// box first, skips boxes farther than the best distance found so far and runs Newton iterations on
+// the remaining pieces only.
+class CurveProjector
+{
+public:
+    struct Result
+    {
+        float u; // curve parameter
+        glm::vec3 point; // closest point on the curve
+        float distance;
+    };
+
+    CurveProjector() = default;
+
+    /**
+     * @brief      Build the hierarchy
+     * @param[in]  segments   Bezier form of the curve (copied)
+     * @param[in]  tolerance  Flatness of the leaf pieces relative to the curve size
+     * @param[in]  maxDepth   Maximum number of halvings per segment
+     */
+    void build(const BezierSegments& segments, const float tolerance = 0.01f, const int maxDepth = 6)
+    {
+        m_segments = segments;
+        m_leaves.clear();
+        m_nodes.clear();
+        if (m_segments.size() == 0)
+            return;
+
+        glm::vec3 lo = m_segments.boundsMin(0), hi = m_segments.boundsMax(0);
+        for (int i = 1; i < m_segments.size(); i++)
+        {
+            lo = glm::min(lo, m_segments.boundsMin(i));
+            hi = glm::max(hi, m_segments.boundsMax(i));
+        }
+        const float flatness = tolerance * max(glm::length(hi - lo), FLT_MIN);
+
+        const int order = m_segments.degree() + 1;
+        for (int i = 0; i < m_segments.size(); i++)
+        {
+            vector<glm::vec4> Q(m_segments.points(i), m_segments.points(i) + order);
+            split(i, 0.0f, 1.0f, Q, flatness, maxDepth);
+        }
+        buildNode(0, m_leaves.size());
+    }
+
+    bool empty() const
+    {
+        return m_nodes.empty();
+    }
+
+    // closest point on the curve to x
+    Result project(const glm::vec3& x) const
+    {
+        Result best = {0.0f, glm::vec3(0.0f), FLT_MAX};
+        if (m_nodes.empty())
+            return best;
+
+        float best2 = FLT_MAX;
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node& node = m_nodes[stack[--top]];
+            if (boxDistance2(node.bmin, node.bmax, x) >= best2)
+                continue;
+
+            if (node.count > 0)
+            {
+                for (int i = node.first; i < node.first + node.count; i++)
+                {
+                    const Leaf& leaf = m_leaves[i];
+                    if (boxDistance2(leaf.bmin, leaf.bmax, x) < best2)
+                        refine(leaf, x, best, best2);
+                }
+                continue;
+            }
+
+            // push the farther child first so the nearer one is visited next
+            const float left = boxDistance2(m_nodes[node.left].bmin, m_nodes[node.left].bmax, x);
+            const float right = boxDistance2(m_nodes[node.right].bmin, m_nodes[node.right].bmax, x);
+            if (left < right)
+            {
+                stack[top++] = node.right;
+                stack[top++] = node.left;
+            }
+            else
+            {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+        best.distance = sqrt(best2);
+        return best;
+    }
+
+    /**
+     * @brief      Project many points, split into contiguous chunks over worker threads
+     * @param[in]  points   Query points
+     * @param[out] results  One result per query point
+     * @param[in]  threads  Worker count, 0 for the hardware concurrency
+     */
+    void projectBatch(const vector<glm::vec3>& points, vector<Result>& results, int threads = 0) const
+    {
+        results.resize(points.size());
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        threads = min(threads, max(1, (int)points.size() / 1024)); // not worth a thread below ~1k queries
+
+        auto work = [&](const size_t first, const size_t last) {
+            for (size_t i = first; i < last; i++)
+                results[i] = project(points[i]);
+        };
+        if (threads == 1)
+        {
+            work(0, points.size());
+            return;
+        }
+
+        vector<thread> workers;
+        const size_t chunk = (points.size() + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            const size_t first = t * chunk, last = min(points.size(), first + chunk);
+            if (first < last)
+                workers.emplace_back(work, first, last);
+        }
+        for (thread& worker : workers)
+            worker.join();
+    }
+
+private:
+    struct Leaf
+    {
+        int segment;
+        float t0, t1; // piece of the segment in local parameters
+        glm::vec3 bmin, bmax;
+    };
+
+    struct Node
+    {
+        glm::vec3 bmin, bmax;
+        int left, right; // children of inner nodes
+        int first, count; // leaf range, count == 0 for inner nodes
+    };
+
+    BezierSegments m_segments;
+    vector<Leaf> m_leaves; // in curve parameter order
+    vector<Node> m_nodes; // m_nodes[0] is the root
+
+    // halve the homogeneous control polygon Q of [t0, t1] until it is flat
+    void split(const int segment, const float t0, const float t1, const vector<glm::vec4>& Q, const float flatness, const int depth)
+    {
+        const int p = Q.size() - 1;
+        Leaf leaf = {segment, t0, t1, glm::vec3(0.0f), glm::vec3(0.0f)};
+        const float deviation = BezierSegments::hull(Q.data(), p, leaf.bmin, leaf.bmax);
+        if (deviation <= flatness || depth == 0)
+        {
+            m_leaves.push_back(leaf);
+            return;
+        }
+
+        vector<glm::vec4> left(p + 1), right(p + 1), temp(Q);
+        BezierSegments::halve(temp.data(), p, left.data(), right.data());
+        const float mid = 0.5f * (t0 + t1);
+        split(segment, t0, mid, left, flatness, depth - 1);
+        split(segment, mid, t1, right, flatness, depth - 1);
+    }
+
+    // median split in parameter order, returns the node index
+    int buildNode(const int first, const int last)
+    {
+        const int index = m_nodes.size();
+        m_nodes.push_back(Node());
+        Node node;
+        node.bmin = m_leaves[first].bmin;
+        node.bmax = m_leaves[first].bmax;
+        for (int i = first + 1; i < last; i++)
+        {
+            node.bmin = glm::min(node.bmin, m_leaves[i].bmin);
+            node.bmax = glm::max(node.bmax, m_leaves[i].bmax);
+        }
+        if (last - first <= 2)
+        {
+            node.left = node.right = -1;
+            node.first = first;
+            node.count = last - first;
+        }
+        else
+        {
+            const int mid = (first + last) / 2;
+            node.first = node.count = 0;
+            node.left = buildNode(first, mid);
+            node.right = buildNode(mid, last);
+        }
+        m_nodes[index] = node;
+        return index;
+    }
+
+    static float boxDistance2(const glm::vec3& bmin, const glm::vec3& bmax, const glm::vec3& x)
+    {
+        glm::vec3 d = glm::max(glm::max(bmin - x, x - bmax), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    // Newton iterations on f(t) = (C(t) - x) . C'(t) = 0 inside the leaf, falling back to bisection
+    // whenever a step leaves the bracket [lo, hi] where f changes sign
+    void refine(const Leaf& leaf, const glm::vec3& x, Result& best, float& best2) const
+    {
+        glm::vec3 ders[3];
+        float lo = leaf.t0, hi = leaf.t1;
+        m_segments.evaluateSegmentDerivatives(leaf.segment, lo, ders);
+        const float flo = glm::dot(ders[1], ders[0] - x);
+        m_segments.evaluateSegmentDerivatives(leaf.segment, hi, ders);
+        const float fhi = glm::dot(ders[1], ders[0] - x);
+
+        float t;
+        if (flo >= 0.0f && fhi <= 0.0f)
+        {
+            // both ends are local minima, the flat piece has no interior minimum
+            const float dlo = glm::length(m_segments.evaluateSegment(leaf.segment, lo) - x);
+            const float dhi = glm::length(ders[0] - x);
+            t = dlo < dhi ? lo : hi;
+        }
+        else if (flo >= 0.0f)
+        {
+            t = lo;
+        }
+        else if (fhi <= 0.0f)
+        {
+            t = hi;
+        }
+        else
+        {
+            t = 0.5f * (lo + hi);
+            for (int iteration = 0; iteration < 16; iteration++)
+            {
+                m_segments.evaluateSegmentDerivatives(leaf.segment, t, ders);
+                const glm::vec3 d = ders[0] - x;
+                const float f = glm::dot(ders[1], d);
+                const float df = glm::dot(ders[2], d) + glm::dot(ders[1], ders[1]);
+                if (f < 0.0f)
+                    lo = t;
+                else
+                    hi = t;
+
+                float next = df > 0.0f ? t - f / df : lo - 1.0f;
+                if (next <= lo || next >= hi)
+                    next = 0.5f * (lo + hi);
+                const bool converged = fabs(next - t) < 1e-7f || hi - lo < 1e-7f;
+                t = next;
+                if (converged)
+                    break;
+            }
+        }
+
+        const glm::vec3 point = m_segments.evaluateSegment(leaf.segment, t);
+        const glm::vec3 d = point - x;
+        const float distance2 = glm::dot(d, d);
+        if (distance2 < best2)
+        {
+            best2 = distance2;
+            const float start = m_segments.start(leaf.segment), end = m_segments.end(leaf.segment);
+            best.u = start + t * (end - start);
+            best.point = point;
+        }
+    }
+};
+#endif
@@ -0,0 +1,287 @@
+#ifndef SEGMENTS_H
+#define SEGMENTS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Piecewise Bezier form of a (rational) B-spline curve.
+// All segments share the curve degree and are stored in flat arrays, segment i owns
+// the homogeneous control points m_points[i * (degree + 1) .. i * (degree + 1) + degree].
+class BezierSegments
+{
+public:
+    BezierSegments() = default;
+
+    /**
+     * @brief      Decompose a B-spline curve into Bezier segments, one per nonempty span of its domain
+     *             [knots[p], knots[n + 1]]; clamped or not
+     * @param[in]  Pw     Homogeneous control points (w * P, w)
+     * @param[in]  knots  Knots array
+     * @param[in]  p      Degree
+     * @note       Bezier point j of the span [a, b] is the blossom of the curve at (a, .., a, b, .., b) with
+     *             j times b, evaluated by de Boor's algorithm on the p + 1 control points of the span. The
+     *             spans are independent, so knots before p and after n + 1 are never read as segment ends
+     */
+    void build(const vector<glm::vec4>& Pw, const vector<float>& knots, const int p)
+    {
+        const int n = Pw.size() - 1;
+        const int order = p + 1;
+        m_degree = p;
+        m_points.clear();
+        m_starts.clear();
+        m_ends.clear();
+        m_binomials.assign(order, 1.0f);
+        for (int i = 1; i < p; i++)
+            m_binomials[i] = m_binomials[i - 1] * (float)(p - i + 1) / (float)i;
+
+        m_points.reserve((n - p + 1) * order);
+        vector<glm::vec4> d(order);
+        for (int i = p; i <= n; i++)
+        {
+            const float a = knots[i], b = knots[i + 1];
+            if (!(b > a))
+                continue;
+            m_starts.push_back(a);
+            m_ends.push_back(b);
+            for (int j = 0; j <= p; j++)
+                m_points.push_back(blossom(Pw, knots, p, i, a, b, p - j, d));
+        }
+        const int nb = m_starts.size();
+
+        // bounding boxes and flatness of the projected control polygons
+        m_boundsMin.resize(nb);
+        m_boundsMax.resize(nb);
+        m_flatness.resize(nb);
+        for (int s = 0; s < nb; s++)
+            m_flatness[s] = hull(&m_points[s * order], p, m_boundsMin[s], m_boundsMax[s]);
+    }
+
+    /**
+     * @brief      Bounding box and flatness of a projected control polygon
+     * @param[in]  Q     Homogeneous control points, p + 1 of them
+     * @param[in]  p     Degree
+     * @param[out] bmin  Box corners, the box contains the curve piece for positive weights
+     * @param[out] bmax
+     * @return     Largest distance of an inner control point from the chord, or from the first point
+     *             when the chord degenerates
+     */
+    static float hull(const glm::vec4* Q, const int p, glm::vec3& bmin, glm::vec3& bmax)
+    {
+        glm::vec3 first = glm::vec3(Q[0]) / Q[0].w;
+        glm::vec3 last = glm::vec3(Q[p]) / Q[p].w;
+        glm::vec3 chord = last - first;
+        float chordLength2 = glm::dot(chord, chord);
+        bmin = glm::min(first, last);
+        bmax = glm::max(first, last);
+        float flatness = 0.0f;
+        for (int k = 1; k < p; k++)
+        {
+            glm::vec3 point = glm::vec3(Q[k]) / Q[k].w;
+            bmin = glm::min(bmin, point);
+            bmax = glm::max(bmax, point);
+            glm::vec3 offset = point - first;
+            if (chordLength2 > 0.0f)
+                offset -= chord * (glm::dot(offset, chord) / chordLength2);
+            flatness = max(flatness, glm::length(offset));
+        }
+        return flatness;
+    }
+
+    // de Casteljau at t = 1/2: the left edge of the triangle controls the first half, the right edge
+    // the second half; Q, left and right hold p + 1 points each, Q is used as scratch
+    static void halve(glm::vec4* Q, const int p, glm::vec4* left, glm::vec4* right)
+    {
+        for (int r = 0; r <= p; r++)
+        {
+            left[r] = Q[0];
+            right[p - r] = Q[p - r];
+            for (int i = 0; i < p - r; i++)
+                Q[i] = 0.5f * (Q[i] + Q[i + 1]);
+        }
+    }
+
+    int size() const
+    {
+        return m_starts.size();
+    }
+
+    int degree() const
+    {
+        return m_degree;
+    }
+
+    // parameter range [start, end] of segment i in the B-spline parameter domain
+    float start(const int i) const
+    {
+        return m_starts[i];
+    }
+
+    float end(const int i) const
+    {
+        return m_ends[i];
+    }
+
+    // homogeneous control points of segment i, degree + 1 of them
+    const glm::vec4* points(const int i) const
+    {
+        return &m_points[i * (m_degree + 1)];
+    }
+
+    // axis aligned box around the control polygon, contains the segment for positive weights
+    const glm::vec3& boundsMin(const int i) const
+    {
+        return m_boundsMin[i];
+    }
+
+    const glm::vec3& boundsMax(const int i) const
+    {
+        return m_boundsMax[i];
+    }
+
+    // largest distance of an inner control point from the chord, 0 for a straight segment
+    float flatness(const int i) const
+    {
+        return m_flatness[i];
+    }
+
+    // segment containing u, clamped to the first/last segment
+    int find(const float u) const
+    {
+        int i = upper_bound(m_starts.begin(), m_starts.end(), u) - m_starts.begin() - 1;
+        return min(max(i, 0), size() - 1);
+    }
+
+    // evaluate segment i at local parameter t in [0, 1]
+    glm::vec3 evaluateSegment(const int i, const float t) const
+    {
+        glm::vec4 point = bernstein(points(i), t);
+        return glm::vec3(point) / point.w;
+    }
+
+    // position and first two derivatives with respect to the local parameter t of segment i
+    void evaluateSegmentDerivatives(const int i, const float t, glm::vec3* ders) const
+    {
+        const glm::vec4* Q = points(i);
+        const int p = m_degree;
+        glm::vec4 A0 = bernsteinSum(p, t, [Q](int k) { return Q[k]; });
+        glm::vec4 A1(0.0f), A2(0.0f);
+        if (p >= 1)
+            A1 = (float)p * bernsteinSum(p - 1, t, [Q](int k) { return Q[k + 1] - Q[k]; });
+        if (p >= 2)
+        {
+            A2 = (float)(p * (p - 1)) *
+                 bernsteinSum(p - 2, t, [Q](int k) { return Q[k + 2] - 2.0f * Q[k + 1] + Q[k]; });
+        }
+
+        // quotient rule for C = A / w
+        ders[0] = glm::vec3(A0) / A0.w;
+        ders[1] = (glm::vec3(A1) - A1.w * ders[0]) / A0.w;
+        ders[2] = (glm::vec3(A2) - 2.0f * A1.w * ders[1] - A2.w * ders[0]) / A0.w;
+    }
+
+    // evaluate the curve at u in the B-spline parameter domain
+    glm::vec3 evaluate(const float u) const
+    {
+        const int i = find(u);
+        const float length = m_ends[i] - m_starts[i];
+        return evaluateSegment(i, length > 0.0f ? (u - m_starts[i]) / length : 0.0f);
+    }
+
+private:
+    int m_degree = 0;
+    vector<glm::vec4> m_points;
+    vector<float> m_starts;
+    vector<float> m_ends;
+    vector<glm::vec3> m_boundsMin;
+    vector<glm::vec3> m_boundsMax;
+    vector<float> m_flatness;
+    vector<float> m_binomials; // C(p, i)
+
+    // blossom of span i (knots[i] < knots[i + 1]) at (a repeated count times, b for the rest), d is scratch
+    // for p + 1 points; every denominator covers the span, so none is zero
+    static glm::vec4 blossom(const vector<glm::vec4>& Pw, const vector<float>& knots, const int p, const int i,
+        const float a, const float b, const int count, vector<glm::vec4>& d)
+    {
+        for (int k = 0; k <= p; k++)
+            d[k] = Pw[i - p + k];
+        for (int r = 1; r <= p; r++)
+        {
+            const float t = r <= count ? a : b;
+            for (int k = p; k >= r; k--)
+            {
+                const int index = i - p + k;
+                const float alpha = (t - knots[index]) / (knots[index + p + 1 - r] - knots[index]);
+                d[k] = (1.0f - alpha) * d[k - 1] + alpha * d[k];
+            }
+        }
+        return d[p];
+    }
+
+    // sum over k of C(d, k) t^k (1 - t)^(d - k) coefficient(k), same Horner scheme as bernstein()
+    // with the binomials generated on the fly
+    template <class Coefficient>
+    static glm::vec4 bernsteinSum(const int d, const float t, Coefficient coefficient)
+    {
+        const float s = 1.0f - t;
+        glm::vec4 sum;
+        float scale = 1.0f;
+        float binomial = 1.0f;
+        if (t < 0.5f)
+        {
+            const float ratio = t / s;
+            sum = coefficient(d);
+            for (int k = d - 1; k >= 0; k--)
+            {
+                binomial = binomial * (float)(k + 1) / (float)(d - k);
+                sum = sum * ratio + binomial * coefficient(k);
+            }
+            for (int k = 0; k < d; k++)
+                scale *= s;
+        }
+        else
+        {
+            const float ratio = s / t;
+            sum = coefficient(0);
+            for (int k = 1; k <= d; k++)
+            {
+                binomial = binomial * (float)(d - k + 1) / (float)k;
+                sum = sum * ratio + binomial * coefficient(k);
+            }
+            for (int k = 0; k < d; k++)
+                scale *= t;
+        }
+        return sum * scale;
+    }
+
+    // Horner scheme on the Bernstein form, in t / (1 - t) or (1 - t) / t whichever stays below one
+    glm::vec4 bernstein(const glm::vec4* Q, const float t) const
+    {
+        const int p = m_degree;
+        const float s = 1.0f - t;
+        glm::vec4 sum;
+        float scale = 1.0f;
+        if (t < 0.5f)
+        {
+            const float ratio = t / s;
+            sum = Q[p];
+            for (int k = p - 1; k >= 0; k--)
+                sum = sum * ratio + m_binomials[k] * Q[k];
+            for (int k = 0; k < p; k++)
+                scale *= s;
+        }
+        else
+        {
+            const float ratio = s / t;
+            sum = Q[0];
+            for (int k = 1; k <= p; k++)
+                sum = sum * ratio + m_binomials[k] * Q[k];
+            for (int k = 0; k < p; k++)
+                scale *= t;
+        }
+        return sum * scale;
+    }
+};
+#endif
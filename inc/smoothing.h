@@ -0,0 +1,206 @@
+#ifndef SMOOTHING_H
+#define SMOOTHING_H
+
+#include "spline.h"
+
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Cubic smoothing spline through noisy control points (Reinsch).
+//
+// Minimises sum |y_i - g(i)|^2 + smoothing * integral |g''|^2 over natural cubic splines g with the same
+// unit knot spacing as SplineCurve. The second derivatives gamma at the inner knots solve the
+// pentadiagonal system (R + smoothing Q^T Q) gamma = Q^T y, the fitted values are g = y - smoothing Q gamma.
+// Both the solve and the generalized cross validation score take one LDL^T factorization, O(n) time and
+// memory. smoothing = 0 gives the interpolating SplineCurve.
+class SmoothingSplineCurve : public SplineCurve
+{
+public:
+    // default constructor
+    SmoothingSplineCurve() = default;
+
+    // constructor
+    SmoothingSplineCurve(vector<glm::vec3> controlPoints, const float smoothing = 1.0f, const int count = 100)
+        : SplineCurve(move(controlPoints), count), m_smoothing(smoothing)
+    {
+    }
+
+    // takes effect with the next Tessellate()
+    void SetSmoothing(const float smoothing)
+    {
+        m_smoothing = smoothing;
+    }
+
+    float GetSmoothing() const
+    {
+        return m_smoothing;
+    }
+
+    // smoothed values at the knots, valid after Tessellate()
+    const vector<glm::vec3>& GetFittedPoints() const
+    {
+        return m_fitted;
+    }
+
+    /**
+     * @brief      Generalized cross validation score (RSS / n) / (1 - tr(S) / n)^2 of a smoothing parameter
+     * @note       tr(S) comes from the central band of the inverse of the factorized matrix
+     *             (Hutchinson and de Hoog), so the score costs one O(n) factorization
+     */
+    float GeneralizedCrossValidation(const float smoothing)
+    {
+        const int n = m_controlPoints.size();
+        if (n < 3)
+            return 0.0f;
+        const double residualTrace = solve(smoothing, true); // tr(I - S)
+        double rss = 0.0;
+        for (int j = 0; j < n; j++)
+        {
+            const glm::dvec3 r = glm::dvec3(m_controlPoints[j]) - m_values[j];
+            rss += glm::dot(r, r);
+        }
+        const double ratio = residualTrace / (double)n;
+        return ratio > 0.0 ? (float)(rss / (double)n / (ratio * ratio)) : 0.0f;
+    }
+
+    /**
+     * @brief      Pick the smoothing parameter with the lowest GCV score by golden section search on
+     *             log(smoothing), then use it
+     * @param[in]  minSmoothing  Search range
+     * @param[in]  maxSmoothing
+     * @return     The selected smoothing parameter
+     */
+    float SelectSmoothing(const float minSmoothing = 1e-4f, const float maxSmoothing = 1e9f)
+    {
+        const float ratio = 0.5f * (sqrt(5.0f) - 1.0f);
+        float a = log(minSmoothing), b = log(maxSmoothing);
+        float c = b - ratio * (b - a), d = a + ratio * (b - a);
+        float fc = GeneralizedCrossValidation(exp(c)), fd = GeneralizedCrossValidation(exp(d));
+        for (int iteration = 0; iteration < 40 && b - a > 1e-3f; iteration++)
+        {
+            if (fc < fd)
+            {
+                b = d;
+                d = c;
+                fd = fc;
+                c = b - ratio * (b - a);
+                fc = GeneralizedCrossValidation(exp(c));
+            }
+            else
+            {
+                a = c;
+                c = d;
+                fc = fd;
+                d = a + ratio * (b - a);
+                fd = GeneralizedCrossValidation(exp(d));
+            }
+        }
+        m_smoothing = exp(0.5f * (a + b));
+        return m_smoothing;
+    }
+
+protected:
+    float m_smoothing = 1.0f;
+    vector<glm::vec3> m_fitted; // smoothed values at the knots
+
+    // LDL^T factors of the pentadiagonal matrix: diagonal, first and second sub-diagonal of L
+    vector<double> m_d, m_l1, m_l2;
+    vector<glm::dvec3> m_gamma; // second derivatives at the inner knots
+    vector<glm::dvec3> m_values; // fitted values in double
+
+    /**
+     * @brief      Factorize R + smoothing Q^T Q, solve for gamma and the fitted values
+     * @return     tr(I - S) = smoothing tr(Q^T Q A^-1) if trace is set, otherwise 0
+     */
+    double solve(const double smoothing, const bool trace)
+    {
+        const int n = m_controlPoints.size();
+        const int m = n - 2;
+        m_d.resize(m);
+        m_l1.resize(m);
+        m_l2.resize(m);
+        m_gamma.resize(m);
+        m_values.resize(n);
+
+        // R: 2/3 on the diagonal, 1/6 beside it; Q^T Q: 6, -4, 1
+        for (int i = 0; i < m; i++)
+        {
+            const double a0 = 2.0 / 3.0 + 6.0 * smoothing;
+            const double a1 = 1.0 / 6.0 - 4.0 * smoothing;
+            const double a2 = smoothing;
+            double d = a0;
+            if (i >= 1)
+                d -= m_l1[i - 1] * m_l1[i - 1] * m_d[i - 1];
+            if (i >= 2)
+                d -= m_l2[i - 2] * m_l2[i - 2] * m_d[i - 2];
+            m_d[i] = d;
+            m_l1[i] = (a1 - (i >= 1 ? m_l2[i - 1] * m_d[i - 1] * m_l1[i - 1] : 0.0)) / d;
+            m_l2[i] = a2 / d;
+
+            // forward substitution with the right hand side (Q^T y)_i
+            glm::dvec3 z = glm::dvec3(m_controlPoints[i]) - 2.0 * glm::dvec3(m_controlPoints[i + 1]) + glm::dvec3(m_controlPoints[i + 2]);
+            if (i >= 1)
+                z -= m_l1[i - 1] * m_gamma[i - 1];
+            if (i >= 2)
+                z -= m_l2[i - 2] * m_gamma[i - 2];
+            m_gamma[i] = z;
+        }
+        for (int i = m - 1; i >= 0; i--)
+        {
+            glm::dvec3 x = m_gamma[i] / m_d[i];
+            if (i + 1 < m)
+                x -= m_l1[i] * m_gamma[i + 1];
+            if (i + 2 < m)
+                x -= m_l2[i] * m_gamma[i + 2];
+            m_gamma[i] = x;
+        }
+
+        // g_j = y_j - smoothing (Q gamma)_j, gamma is zero at the end knots
+        auto gamma = [this, m](const int node) { return node >= 1 && node <= m ? m_gamma[node - 1] : glm::dvec3(0.0); };
+        for (int j = 0; j < n; j++)
+            m_values[j] = glm::dvec3(m_controlPoints[j]) - smoothing * (gamma(j - 1) - 2.0 * gamma(j) + gamma(j + 1));
+
+        if (!trace)
+            return 0.0;
+
+        // central band of A^-1 from the factors, from the last row up
+        double s00 = 0.0, s01 = 0.0, s11 = 0.0; // Sigma(i+1, i+1), Sigma(i+1, i+2), Sigma(i+2, i+2)
+        double sum = 0.0;
+        for (int i = m - 1; i >= 0; i--)
+        {
+            const double l1 = i + 1 < m ? m_l1[i] : 0.0, l2 = i + 2 < m ? m_l2[i] : 0.0;
+            const double sigma02 = -l1 * s01 - l2 * s11;
+            const double sigma01 = -l1 * s00 - l2 * s01;
+            const double sigma00 = 1.0 / m_d[i] - l1 * sigma01 - l2 * sigma02;
+            sum += 6.0 * sigma00 - 8.0 * sigma01 + 2.0 * sigma02;
+            s11 = s00;
+            s01 = sigma01;
+            s00 = sigma00;
+        }
+        return smoothing * sum;
+    }
+
+private:
+    // create draw vertices according to control points and parameter domain
+    void createDrawVertices() override
+    {
+        const int size = m_controlPoints.size();
+        m_fitted = m_controlPoints;
+        m_M.assign(size, glm::vec3(0.0f));
+        if (size >= 3)
+        {
+            solve(m_smoothing, false);
+            for (int j = 0; j < size; j++)
+                m_fitted[j] = glm::vec3(m_values[j]);
+            for (int i = 0; i < size - 2; i++)
+                m_M[i + 1] = glm::vec3(m_gamma[i]);
+        }
+        if (size >= 2)
+        {
+            m_vertices.reserve((size - 1) * (m_count / (size - 1) + 1));
+            createSegmentVertices(m_fitted);
+        }
+    }
+};
+#endif
@@ -7,64 +7,39 @@ using namespace std;
 
 #define pow3(x) x*x*x
 
-class SplineCurve : public BasisCurve
+// Natural cubic spline through points with unit knot spacing, in scalar type T: float for the draw
+// vertices, double for offline jobs that need the precision. The second derivatives M at the points solve
+// a tridiagonal system, segment i is evaluated from the points and M at its two ends.
+template <typename T>
+class CubicSplineSolver
 {
 public:
-	// default constructor
-	SplineCurve() = default;
-
-	// constructor
-	SplineCurve(const vector<glm::vec3>& controlPoints, const int count = 100)
-		: BasisCurve(controlPoints, count)
-	{
-	}
-
-protected:
-	// diagonal elements of tridiagonal matrix
-    vector<glm::vec3> m_diag;
-	vector<glm::vec3> m_upper;
-	vector<glm::vec3> m_lower;
-
-	vector<glm::vec3> m_b;
-    vector<glm::vec3> m_v;
-    vector<glm::vec3> m_M;
-
-	vector<glm::vec3> m_y;
+    using Point = glm::vec<3, T>;
 
-private:
-	// SplineCurve initial method
-	void init() override
-	{
-		int size = m_controlPoints.size();
+    // second derivatives at the points, zero at both ends
+    void solve(const vector<Point>& points, vector<Point>& M)
+    {
+		// create tridiagonal matrix
+        int size = points.size();
         m_diag.resize(size - 1);
         m_upper.resize(size - 1);
         m_lower.resize(size - 1);
         m_b.resize(size - 1);
         m_v.resize(size - 1);
-        m_M.resize(size);
+        M.resize(size);
         m_y.resize(size - 1);
 
-		createDrawVertices();
-        initDrawConfig();
-	}
-
-	// create draw vertices according to control points and parameter domain
-	void createDrawVertices() override
-	{
-		// create tridiagonal matrix
-        int size = m_controlPoints.size();
-        
 		for (int i = 0; i < size - 1; i++)
         {
-            m_upper[i] = m_lower[i] = glm::vec3(1.0f);
-            m_b[i] = 6.0f / m_upper[i] * (m_controlPoints[i + 1] - m_controlPoints[i]);
+            m_upper[i] = m_lower[i] = Point(T(1));
+            m_b[i] = T(6) / m_upper[i] * (points[i + 1] - points[i]);
             if (i > 0)
             {
-                m_diag[i] = 2.0f * (m_upper[i] + m_upper[i - 1]);
+                m_diag[i] = T(2) * (m_upper[i] + m_upper[i - 1]);
                 m_v[i] = m_b[i] - m_b[i - 1];
             }
         }
-		
+
 		// solve tridiagonal matrix
 		for (int i = 1; i < size - 2; i++)
 		{
@@ -78,26 +53,76 @@ private:
 			m_y[i] = m_v[i] - m_lower[i - 1] * m_y[i - 1];
 		}
 
-		m_M[0] = m_M[size - 1] = glm::vec3(0.0f);
-		m_M[size - 2] = m_y[size - 2] / m_diag[size - 2];
+		M[0] = M[size - 1] = Point(T(0));
+		M[size - 2] = m_y[size - 2] / m_diag[size - 2];
 		for (int i = size - 3; i > 0; i--)
 		{
-			m_M[i] = (m_y[i] - m_upper[i] * m_M[i + 1]) / m_diag[i];
+			M[i] = (m_y[i] - m_upper[i] * M[i + 1]) / m_diag[i];
 		}
+    }
 
-		// create draw vertices
+    // append perSegment + 1 samples of every segment, the ratio of sample j is j / perSegment
+    static void sample(const vector<Point>& points, const vector<Point>& M, const int perSegment, vector<Point>& vertices)
+    {
+        const int size = points.size();
         for (int i = 0; i < size - 1; i++)
         {
-            for (int j = 0; j <= m_count / (size - 1); j++)
+            for (int j = 0; j <= perSegment; j++)
             {
-                float ratio = (float)j / (float)(m_count / (size - 1));
-                //std::cout << ((m_controlPoints[i + 1] - m_M[i + 1] / 6.0f) * ratio).x << std::endl;
-                m_vertices.push_back(pow3((1.0f - ratio)) * m_M[i] / 6.0f +
-                                     pow3(ratio) * m_M[i + 1] / 6.0f +
-                                     (m_controlPoints[i] - m_M[i] / 6.0f) * (1 - ratio) +
-                                     (m_controlPoints[i + 1] - m_M[i + 1] / 6.0f) * ratio);
+                T ratio = (T)j / (T)perSegment;
+                vertices.push_back(pow3((T(1) - ratio)) * M[i] / T(6) +
+                                   pow3(ratio) * M[i + 1] / T(6) +
+                                   (points[i] - M[i] / T(6)) * (T(1) - ratio) +
+                                   (points[i + 1] - M[i + 1] / T(6)) * ratio);
             }
         }
+    }
+
+private:
+	// diagonal elements of tridiagonal matrix
+    vector<Point> m_diag;
+	vector<Point> m_upper;
+	vector<Point> m_lower;
+
+	vector<Point> m_b;
+    vector<Point> m_v;
+	vector<Point> m_y;
+};
+
+class SplineCurve : public BasisCurve
+{
+public:
+	// default constructor
+	SplineCurve() = default;
+
+	// constructor
+	SplineCurve(vector<glm::vec3> controlPoints, const int count = 100)
+		: BasisCurve(move(controlPoints), count)
+	{
+	}
+
+protected:
+    CubicSplineSolver<float> m_solver;
+    vector<glm::vec3> m_M;
+
+    // append the vertices of the cubic segments through points, with second derivatives m_M at the points
+    void createSegmentVertices(const vector<glm::vec3>& points)
+    {
+        const int size = points.size();
+        if (size >= 2)
+            CubicSplineSolver<float>::sample(points, m_M, m_count / (size - 1), m_vertices);
+    }
+
+private:
+	// create draw vertices according to control points and parameter domain
+	void createDrawVertices() override
+	{
+        int size = m_controlPoints.size();
+        m_vertices.reserve((size - 1) * (m_count / (size - 1) + 1));
+        m_solver.solve(m_controlPoints, m_M);
+
+		// create draw vertices
+        createSegmentVertices(m_controlPoints);
 
 		//for (int i = 0; i < m_vertices.size(); i++)
 		//{
@@ -105,4 +130,4 @@ private:
 		//}
 	}
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,273 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include "view.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Slab storage for many curves of one type, e.g. all curves of a scene.
+//
+// Curves are constructed in place in blocks of blockSize objects instead of one heap allocation each, so
+// they sit next to each other and batch operations walk them in memory order. A curve keeps its address
+// until it is destroyed; its slot is reused by a later create(). clear() destroys all curves but keeps the
+// blocks, so loading the next scene does not go back to the heap for the curve objects.
+template <typename Curve>
+class CurveStore
+{
+public:
+    explicit CurveStore(const int blockSize = 256)
+        : m_blockSize(max(blockSize, 1))
+    {
+    }
+
+    ~CurveStore()
+    {
+        clear();
+    }
+
+    CurveStore(const CurveStore&) = delete;
+    CurveStore& operator=(const CurveStore&) = delete;
+
+    // construct a curve in the store, same arguments as the Curve constructor
+    template <typename... Args>
+    Curve* create(Args&&... args)
+    {
+        Slot* slot = nullptr;
+        if (!m_free.empty())
+        {
+            slot = m_free.back();
+        }
+        else
+        {
+            if (m_used == m_blocks.size() * m_blockSize)
+                m_blocks.emplace_back(new Slot[m_blockSize]);
+            slot = &m_blocks[m_used / m_blockSize][m_used % m_blockSize];
+        }
+        Curve* curve = new (slot->storage) Curve(forward<Args>(args)...);
+
+        // the slot is taken only once the constructor succeeded
+        if (!m_free.empty() && m_free.back() == slot)
+            m_free.pop_back();
+        else
+            m_used++;
+        slot->alive = true;
+        m_size++;
+        return curve;
+    }
+
+    // destroy a curve created by this store, its slot is reused
+    void destroy(Curve* curve)
+    {
+        Slot* slot = reinterpret_cast<Slot*>(curve);
+        curve->~Curve();
+        slot->alive = false;
+        m_free.push_back(slot);
+        m_size--;
+    }
+
+    // destroy all curves, the blocks stay allocated for reuse
+    void clear()
+    {
+        forEach([](Curve& curve) { curve.~Curve(); });
+        for (auto& block : m_blocks)
+            for (int i = 0; i < m_blockSize; i++)
+                block[i].alive = false;
+        m_free.clear();
+        m_used = 0;
+        m_size = 0;
+    }
+
+    // call f(Curve&) for every live curve in memory order
+    template <typename Function>
+    void forEach(Function f)
+    {
+        for (size_t i = 0; i < m_used; i++)
+        {
+            Slot& slot = m_blocks[i / m_blockSize][i % m_blockSize];
+            if (slot.alive)
+                f(*reinterpret_cast<Curve*>(slot.storage));
+        }
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+private:
+    // storage first, so a Curve* converts back to its slot
+    struct Slot
+    {
+        alignas(Curve) unsigned char storage[sizeof(Curve)];
+        bool alive = false;
+    };
+
+    int m_blockSize;
+    vector<unique_ptr<Slot[]>> m_blocks;
+    vector<Slot*> m_free; // slots of destroyed curves
+    size_t m_used = 0; // slots handed out so far, in block order
+    int m_size = 0; // live curves
+};
+
+// Bump allocator over large blocks. Nothing is freed on its own; reset() makes all the memory available
+// again at once and keeps the blocks. Only for trivially destructible data. Alignments are powers of two,
+// applied to the address itself so that they may exceed what the heap guarantees for the blocks.
+class Arena
+{
+public:
+    explicit Arena(const size_t blockBytes = 1 << 20)
+        : m_blockBytes(blockBytes)
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(const size_t bytes, const size_t alignment)
+    {
+        while (true)
+        {
+            if (m_block < m_blocks.size())
+            {
+                const uintptr_t base = reinterpret_cast<uintptr_t>(m_blocks[m_block].data.get());
+                const size_t offset = ((base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+                if (offset + bytes <= m_blocks[m_block].size)
+                {
+                    m_offset = offset + bytes;
+                    return m_blocks[m_block].data.get() + offset;
+                }
+                m_block++;
+                m_offset = 0;
+                continue;
+            }
+            // oversized requests get a block of their own
+            const size_t size = max(m_blockBytes, bytes + alignment);
+            m_blocks.push_back({ unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+        }
+    }
+
+    // n uninitialized values of T
+    template <typename T>
+    T* allocate(const size_t n)
+    {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // copy of n values of T
+    template <typename T>
+    T* copy(const T* values, const size_t n)
+    {
+        T* out = allocate<T>(n);
+        if (n > 0)
+            memcpy(out, values, n * sizeof(T));
+        return out;
+    }
+
+    void reset()
+    {
+        m_block = 0;
+        m_offset = 0;
+    }
+
+    // bytes reserved from the heap
+    size_t capacity() const
+    {
+        size_t bytes = 0;
+        for (const Block& block : m_blocks)
+            bytes += block.size;
+        return bytes;
+    }
+
+private:
+    struct Block
+    {
+        unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    size_t m_blockBytes;
+    vector<Block> m_blocks;
+    size_t m_block = 0; // block being filled
+    size_t m_offset = 0; // first free byte in it
+};
+
+// Evaluation-only B-splines of a scene with all their arrays in one arena.
+//
+// create() copies the control points, knots and weights into the arena and returns a BsplineView over
+// them, itself placed in the arena. The curves of a scene end up in a few large blocks next to each other
+// instead of millions of small vectors, and since views own nothing, clear() drops the whole scene without
+// visiting the curves. Consecutive curves with the same knots and degree share one copy of the knots.
+class BsplineViewStore
+{
+public:
+    explicit BsplineViewStore(const size_t blockBytes = 1 << 20)
+        : m_arena(blockBytes)
+    {
+    }
+
+    /**
+     * @brief      Add a curve to the store
+     * @param[in]  controlPoints  Control points, copied
+     * @param[in]  knots          Knots array, controlPoints.size() + p + 1 knots, copied
+     * @param[in]  p              Degree
+     * @param[in]  weights        Weights of a NURBS curve, empty for a non-rational one, copied
+     * @return     The curve, valid until clear()
+     */
+    const BsplineView* create(const vector<glm::vec3>& controlPoints, const vector<float>& knots, const int p,
+        const vector<float>& weights = vector<float>())
+    {
+        const glm::vec3* P = m_arena.copy(controlPoints.data(), controlPoints.size());
+        if (!m_knots || p != m_p || knots.size() != m_knotsSize || memcmp(m_knots, knots.data(), knots.size() * sizeof(float)) != 0)
+        {
+            m_knots = m_arena.copy(knots.data(), knots.size());
+            m_knotsSize = knots.size();
+            m_p = p;
+        }
+        const float* w = weights.empty() ? nullptr : m_arena.copy(weights.data(), weights.size());
+        BsplineView* view = new (m_arena.allocate<BsplineView>(1)) BsplineView(P, controlPoints.size(), m_knots, p, w);
+        m_views.push_back(view);
+        return view;
+    }
+
+    int size() const
+    {
+        return m_views.size();
+    }
+
+    const BsplineView& operator[](const int i) const
+    {
+        return *m_views[i];
+    }
+
+    // drop all curves, the arena keeps its blocks for the next scene
+    void clear()
+    {
+        m_views.clear();
+        m_arena.reset();
+        m_knots = nullptr;
+    }
+
+    const Arena& arena() const
+    {
+        return m_arena;
+    }
+
+private:
+    Arena m_arena;
+    vector<const BsplineView*> m_views;
+
+    // knots of the last curve, shared by the next one if equal
+    const float* m_knots = nullptr;
+    size_t m_knotsSize = 0;
+    int m_p = 0;
+};
+#endif
@@ -0,0 +1,225 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "fitting.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Sliding window least squares fit of a uniform cubic B-spline to an unbounded stream of samples.
+//
+// Control point i has the knots t0 + (i - 3 .. i + 1) * spacing, a sample in span s = floor((t - t0) / spacing)
+// touches the control points s .. s + 3 through the constant uniform cubic basis. Only the last
+// window + 3 control points are open: every sample adds its 4 x 4 outer product to their banded normal
+// equations (O(1) per sample), a second difference penalty keeps the fit smooth and sparse spans solvable.
+// Once a control point can no longer be touched by new samples and the window is full, the window is
+// solved and the oldest point is finalised: its value moves to the right hand side of its neighbours and
+// its row is recycled. Memory is bounded by the window.
+//
+// Cost of push(): O(1) for a sample in an open span. A sample that opens new spans finalises all the points
+// that have to make room from one banded solve of the window, O(window) (times p^2 = 9), so a regular stream
+// pays one solve per span; a gap of more than a window of spans pays one solve per window of skipped spans,
+// which is O(1) per finalised point. provisional() and flush() cost one solve each.
+class StreamingSplineFitter
+{
+public:
+    /**
+     * @brief      Streaming fitter constructor
+     * @param[in]  spacing    Knot spacing in time units
+     * @param[in]  window     Number of open spans (at least 2)
+     * @param[in]  smoothing  Weight of the second difference penalty per control point
+     */
+    StreamingSplineFitter(const double spacing, const int window = 16, const float smoothing = 1e-3f)
+        : m_spacing(spacing), m_capacity(max(window, 2) + 3), m_smoothing(smoothing)
+    {
+        m_band.resize(m_capacity * 4);
+        m_rhs.resize(m_capacity);
+        m_solveBand.reserve(m_capacity * 4);
+        m_solveRhs.reserve(m_capacity);
+    }
+
+    // forget everything, the next sample starts a new curve
+    void reset()
+    {
+        m_started = false;
+        m_first = m_end = 0;
+        m_finalized.clear();
+    }
+
+    // add a sample, times have to be non-decreasing
+    void push(const double t, const glm::vec3& x)
+    {
+        if (!m_started)
+        {
+            m_t0 = t;
+            m_started = true;
+        }
+        const double position = (t - m_t0) / m_spacing;
+        const int span = (int)floor(position);
+
+        // open the control points of the span, finalising the oldest ones when the window is full: all
+        // that have to make room at once, from a single solve, keeping the two newest open for the
+        // smoothing term of the next point
+        while (m_end <= span + 3)
+        {
+            if (m_end - m_first == m_capacity)
+                finalizeOldest(min(span + 4 - m_end, m_capacity - 2));
+            openPoint();
+        }
+
+        float b[4];
+        basis((float)(position - span), b);
+        addTerm(span, b, 4, glm::dvec3(x), 1.0);
+    }
+
+    // finalise all open control points, e.g. at the end of the stream
+    void flush()
+    {
+        if (m_first == m_end)
+            return;
+        solveWindow();
+        for (int i = 0; i < m_end - m_first; i++)
+            m_finalized.push_back(glm::vec3(m_solveRhs[i]));
+        m_first = m_end;
+    }
+
+    // move the control points finalised since the last call to the end of out
+    void takeFinalized(vector<glm::vec3>& out)
+    {
+        out.insert(out.end(), m_finalized.begin(), m_finalized.end());
+        m_finalized.clear();
+    }
+
+    // current estimate of the open control points, first() .. first() + size - 1
+    void provisional(vector<glm::vec3>& out)
+    {
+        out.clear();
+        if (m_first == m_end)
+            return;
+        solveWindow();
+        for (int i = 0; i < m_end - m_first; i++)
+            out.push_back(glm::vec3(m_solveRhs[i]));
+    }
+
+    // index of the oldest open control point, equals the number of finalised ones
+    int first() const
+    {
+        return m_first;
+    }
+
+    // knot i of the uniform knots array, control point i spans [knot(i), knot(i + 4)]
+    double knot(const int i) const
+    {
+        return m_t0 + (double)(i - 3) * m_spacing;
+    }
+
+    // uniform cubic B-spline basis at local parameter u in [0, 1]
+    static void basis(const float u, float* b)
+    {
+        const float u2 = u * u, u3 = u2 * u;
+        const float s = 1.0f - u;
+        b[0] = s * s * s / 6.0f;
+        b[1] = (3.0f * u3 - 6.0f * u2 + 4.0f) / 6.0f;
+        b[2] = (-3.0f * u3 + 3.0f * u2 + 3.0f * u + 1.0f) / 6.0f;
+        b[3] = u3 / 6.0f;
+    }
+
+private:
+    double m_spacing;
+    int m_capacity; // open control points
+    float m_smoothing;
+    bool m_started = false;
+    double m_t0 = 0.0;
+    int m_first = 0; // oldest open control point
+    int m_end = 0; // one past the newest open control point
+
+    // normal equations of the open points in a ring: row i at (i % capacity) * 4, entry d = A(i, i + d)
+    vector<double> m_band;
+    vector<glm::dvec3> m_rhs;
+    vector<glm::vec3> m_finalized;
+
+    // scratch for the window solve, sized once
+    vector<double> m_solveBand;
+    vector<glm::dvec3> m_solveRhs;
+
+    double& entry(const int i, const int d)
+    {
+        return m_band[(i % m_capacity) * 4 + d];
+    }
+
+    glm::dvec3& rhs(const int i)
+    {
+        return m_rhs[i % m_capacity];
+    }
+
+    void openPoint()
+    {
+        const int i = m_end++;
+        for (int d = 0; d < 4; d++)
+            entry(i, d) = 0.0;
+        rhs(i) = glm::dvec3(0.0);
+        if (i >= 2)
+        {
+            const float d2[3] = {1.0f, -2.0f, 1.0f};
+            addTerm(i - 2, d2, 3, glm::dvec3(0.0), m_smoothing);
+        }
+    }
+
+    // weight * |sum_j c[j] P[k + j] - y|^2 into the normal equations, all indices open
+    void addTerm(const int k, const float* c, const int count, const glm::dvec3& y, const double weight)
+    {
+        for (int a = 0; a < count; a++)
+        {
+            const double wa = weight * (double)c[a];
+            rhs(k + a) += wa * y;
+            for (int b = a; b < count; b++)
+                entry(k + a, b - a) += wa * (double)c[b];
+        }
+    }
+
+    // solve the open window into m_solveRhs
+    void solveWindow()
+    {
+        const int size = m_end - m_first;
+        m_solveBand.resize(size * 4);
+        m_solveRhs.resize(size);
+        double diagonal = 0.0;
+        for (int i = 0; i < size; i++)
+        {
+            for (int d = 0; d < 4; d++)
+                m_solveBand[i * 4 + d] = entry(m_first + i, d);
+            m_solveRhs[i] = rhs(m_first + i);
+            diagonal = max(diagonal, m_solveBand[i * 4]);
+        }
+        if (BsplineFitter::solveBanded(m_solveBand, m_solveRhs, 3))
+            return;
+
+        // no data in some spans and nothing finalised yet to anchor them: add a small ridge
+        for (int i = 0; i < size; i++)
+        {
+            for (int d = 0; d < 4; d++)
+                m_solveBand[i * 4 + d] = entry(m_first + i, d);
+            m_solveBand[i * 4] += 1e-9 * max(diagonal, 1.0);
+            m_solveRhs[i] = rhs(m_first + i);
+        }
+        BsplineFitter::solveBanded(m_solveBand, m_solveRhs, 3);
+    }
+
+    // fix the count oldest open points at one window solution and eliminate them from the system
+    void finalizeOldest(const int count)
+    {
+        solveWindow();
+        for (int k = 0; k < count; k++)
+        {
+            const glm::dvec3 P = m_solveRhs[k];
+            m_finalized.push_back(glm::vec3(P));
+            for (int d = 1; d < 4 && m_first + d < m_end; d++)
+                rhs(m_first + d) -= entry(m_first, d) * P;
+            m_first++;
+        }
+    }
+};
+#endif
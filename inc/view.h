@@ -0,0 +1,107 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include "bspline.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+using namespace std;
+
+// Non-owning, evaluation-only B-spline over memory owned by the caller, e.g. a memory-mapped file of
+// millions of control points.
+//
+// Nothing is copied: the view keeps pointers to the control points, knots and optional weights, which
+// have to outlive it and stay unchanged. It has the evaluation interface of BsplineCurve, so it works with
+// ArcLengthTable and the other helpers that only evaluate. Curves that are drawn, edited or refined need
+// to own their data and are built as BsplineCurve, by moving the arrays in.
+class BsplineView
+{
+public:
+    /**
+     * @brief      View constructor
+     * @param[in]  controlPoints  size control points
+     * @param[in]  size           Number of control points
+     * @param[in]  knots          size + p + 1 knots
+     * @param[in]  p              Degree
+     * @param[in]  weights        size weights for a NURBS curve, nullptr for a non-rational one
+     */
+    BsplineView(const glm::vec3* controlPoints, const int size, const float* knots, const int p, const float* weights = nullptr)
+        : m_controlPoints(controlPoints), m_size(size), m_knots(knots), m_p(p), m_weights(weights)
+    {
+    }
+
+    int GetDegree() const
+    {
+        return m_p;
+    }
+
+    int GetSize() const
+    {
+        return m_size;
+    }
+
+    const float* GetKnots() const
+    {
+        return m_knots;
+    }
+
+    // see BsplineCurve::EvaluateBasis
+    template <typename T>
+    int EvaluateBasis(const T u, const int k, BsplineCurve::DerivativeWorkspaceT<T>& workspace) const
+    {
+        return BsplineCurve::evaluateBasis(m_knots, m_size - 1, m_p, u, k, workspace);
+    }
+
+    // position and derivatives 0..k at u into ders[0..k]
+    template <typename T>
+    void EvaluateDerivatives(const T u, const int k, glm::vec<3, T>* ders, BsplineCurve::DerivativeWorkspaceT<T>& workspace) const
+    {
+        const int p = m_p;
+        const int du = min(k, p); // derivatives above the degree vanish
+        if ((int)workspace.Aders.size() < k + 1)
+            workspace.Aders.resize(k + 1);
+        const int span = EvaluateBasis(u, du, workspace);
+
+        glm::vec<4, T>* Aders = &workspace.Aders[0];
+        for (int j = 0; j <= k; j++)
+            Aders[j] = glm::vec<4, T>(0);
+        for (int j = 0; j <= du; j++)
+        {
+            for (int r = 0; r <= p; r++)
+            {
+                const int i = span - p + r;
+                const T w = m_weights ? (T)m_weights[i] : T(1);
+                Aders[j] += workspace.basisDers[j * (p + 1) + r] * glm::vec<4, T>(glm::vec<3, T>(m_controlPoints[i]) * w, w);
+            }
+        }
+
+        if (m_weights)
+        {
+            BasisCurve::rationalDerivatives(Aders, k, ders);
+        }
+        else
+        {
+            for (int j = 0; j <= k; j++)
+                ders[j] = glm::vec<3, T>(Aders[j]);
+        }
+    }
+
+    // batch form, ders[i * (k + 1) + j] is the j-th derivative at us[i]
+    template <typename T>
+    void EvaluateDerivatives(const vector<T>& us, const int k, vector<glm::vec<3, T>>& ders) const
+    {
+        ders.assign(us.size() * (k + 1), glm::vec<3, T>(0));
+        BsplineCurve::DerivativeWorkspaceT<T> workspace;
+        for (int s = 0; s < (int)us.size(); s++)
+            EvaluateDerivatives(us[s], k, &ders[s * (k + 1)], workspace);
+    }
+
+private:
+    const glm::vec3* m_controlPoints;
+    int m_size;
+    const float* m_knots;
+    int m_p;
+    const float* m_weights; // nullptr for non-rational curves
+};
+#endif
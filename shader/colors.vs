@@ -1,5 +1,8 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+// dequantization of normalized integer vertices, (0, 1) for floats
+uniform vec3 origin;
+uniform vec3 extent;
 //uniform mat4 model;
 //uniform mat4 view;
 //uniform mat4 projection;
@@ -7,5 +10,5 @@ layout (location = 0) in vec3 aPos;
 void main()
 {
 	//gl_Position = projection * view * model * vec4(aPos, 1.0);
-    gl_Position = vec4(aPos, 1.0);
+    gl_Position = vec4(origin + aPos * extent, 1.0);
 }
\ No newline at end of file
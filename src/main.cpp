@@ -1,5 +1,7 @@
 #include <glad/glad.h>
+#ifdef BSPLINE_HAS_GLFW
 #include <GLFW/glfw3.h>
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -7,13 +9,30 @@
 #include "bezier.h"
 #include "spline.h"
 #include "bspline.h"
+#include "headless.h"
+#include "profiler.h"
 #include "shader.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
+#ifdef BSPLINE_HAS_GLFW
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+GLFWwindow* createWindow(const bool visible);
+int runWindowed();
+#endif
+int runHeadless(const int frames, const std::string& imagePath, const std::string& statsPath);
+void createCurve();
+unsigned int createFramebuffer(const unsigned int width, const unsigned int height);
+void renderScene(Shader& colorShader, Shader& colorIdShader, const unsigned int sceneFramebuffer);
+bool writeImage(const std::string& path, const unsigned int width, const unsigned int height);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -26,9 +45,51 @@ glm::vec4 lastPos;
 // dragging id
 unsigned int draggingId = 255;
 
+// show per-phase timings in the window title (only with BSPLINE_PROFILE)
+bool showStats = true;
+
 BasisCurve* basisCurve;
 
-int main()
+// error budget of the uploaded curve vertices, 0 uploads floats
+float vertexPrecision = 0.0f;
+
+// usage: Bspline [--headless [--frames N] [--image file.ppm] [--stats file.txt]] [--vertex-precision E]
+int main(int argc, char** argv)
+{
+    [[maybe_unused]] bool headless = false; // builds without glfw are always headless
+    int frames = 300;
+    std::string imagePath = "bspline_headless.ppm";
+    std::string statsPath = "bspline_headless_stats.txt";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+            imagePath = argv[++i];
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+            statsPath = argv[++i];
+        else if (strcmp(argv[i], "--vertex-precision") == 0 && i + 1 < argc)
+            vertexPrecision = (float)atof(argv[++i]);
+        else
+        {
+            std::cout << "usage: Bspline [--headless [--frames N] [--image file.ppm] [--stats file.txt]] [--vertex-precision E]" << std::endl;
+            return -1;
+        }
+    }
+
+#ifdef BSPLINE_HAS_GLFW
+    if (!headless)
+        return runWindowed();
+#endif
+    return runHeadless(frames, imagePath, statsPath);
+}
+
+#ifdef BSPLINE_HAS_GLFW
+// glfw: create a 3.3 core window, make it current and load all OpenGL function pointers
+// --------------------------------------------------------------------------------------
+GLFWwindow* createWindow(const bool visible)
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -36,6 +97,7 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -48,19 +110,29 @@ int main()
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return -1;
+        return NULL;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        glfwTerminate();
+        return NULL;
     }
+    return window;
+}
+
+int runWindowed()
+{
+    GLFWwindow* window = createWindow(true);
+    if (window == NULL)
+        return -1;
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetKeyCallback(window, keyCallback);
 
     // configure global opengl state
     // -----------------------------
@@ -71,7 +143,171 @@ int main()
     Shader colorShader("colors.vs", "colors.fs");
     Shader colorIdShader("colorsId.vs", "colorsId.fs");
 
-    // construct curve
+    createCurve();
+
+    glPointSize(10.0f);
+    float ans;
+    glGetFloatv(GL_POINT_SIZE, &ans);
+    std::cout << ans << std::endl;
+
+    framebuffer = createFramebuffer(SCR_WIDTH, SCR_HEIGHT);
+
+    // render loop
+    // -----------
+#ifdef BSPLINE_PROFILE
+    double lastStatsTime = glfwGetTime();
+#endif
+    while (!glfwWindowShouldClose(window))
+    {
+        PROFILE_BEGIN_FRAME();
+
+        // input
+        // -----
+        {
+            PROFILE_CPU_SCOPE("Input");
+            processInput(window);
+        }
+
+        renderScene(colorShader, colorIdShader, 0);
+
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        {
+            PROFILE_CPU_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        glfwPollEvents();
+
+        PROFILE_END_FRAME();
+#ifdef BSPLINE_PROFILE
+        // stats overlay: refresh the averaged phase timings twice a second
+        if (glfwGetTime() - lastStatsTime > 0.5)
+        {
+            std::string stats = Profiler::instance().summary();
+            glfwSetWindowTitle(window, showStats ? ("Bspline  " + stats).c_str() : "Bspline");
+            lastStatsTime = glfwGetTime();
+        }
+#endif
+    }
+
+#ifdef BSPLINE_PROFILE
+    if (Profiler::instance().writeChromeTrace("bspline_trace.json"))
+        std::cout << "profile written to bspline_trace.json" << std::endl;
+#endif
+
+    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // ------------------------------------------------------------------
+    glfwTerminate();
+    return 0;
+}
+#endif
+
+// render the scene into an offscreen framebuffer without showing a window,
+// dragging one control point every frame so tessellation and upload are part of the measurement
+int runHeadless(const int frames, const std::string& imagePath, const std::string& statsPath)
+{
+    // context: EGL surfaceless when available, otherwise a hidden glfw window
+    // ------------------------------------------------------------------------
+#ifdef BSPLINE_HAS_EGL
+    HeadlessContext context;
+    if (!context.create())
+        return -1;
+#else
+    GLFWwindow* window = createWindow(false);
+    if (window == NULL)
+        return -1;
+#endif
+
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+
+    Shader colorShader("colors.vs", "colors.fs");
+    Shader colorIdShader("colorsId.vs", "colorsId.fs");
+
+    createCurve();
+    glPointSize(10.0f);
+
+    framebuffer = createFramebuffer(SCR_WIDTH, SCR_HEIGHT);
+    unsigned int sceneFramebuffer = createFramebuffer(SCR_WIDTH, SCR_HEIGHT);
+
+    // render loop
+    // -----------
+    const unsigned int dragId = 3;
+    const glm::vec3 step(0.0f, 0.004f, 0.0f);
+    std::vector<double> frameTimes(frames), submitTimes(frames);
+    for (int i = 0; i < frames; i++)
+    {
+        PROFILE_BEGIN_FRAME();
+        auto start = std::chrono::steady_clock::now();
+
+        // move the point up and down in 50 frame swings
+        basisCurve->Update(dragId, (i / 50) % 2 == 0 ? step : -step);
+        renderScene(colorShader, colorIdShader, sceneFramebuffer);
+        submitTimes[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // wait for the GPU so the frame time covers the whole pipeline
+        {
+            PROFILE_CPU_SCOPE("Finish");
+            glFinish();
+        }
+        frameTimes[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        PROFILE_END_FRAME();
+    }
+
+    // timing stats
+    // ------------
+    std::vector<double> sorted(frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0, submitTotal = 0.0;
+    for (int i = 0; i < frames; i++)
+    {
+        total += frameTimes[i];
+        submitTotal += submitTimes[i];
+    }
+
+    const VertexFormat format = basisCurve->GetVertexFormat();
+    std::ostringstream stats;
+    stats << "renderer        " << (const char*)glGetString(GL_RENDERER) << "\n"
+          << "version         " << (const char*)glGetString(GL_VERSION) << "\n"
+          << "resolution      " << SCR_WIDTH << "x" << SCR_HEIGHT << "\n"
+          << "frames          " << frames << "\n"
+          << "control points  " << basisCurve->GetControlPoints().size() << "\n"
+          << "vertices        " << basisCurve->GetVertexCount() << "\n"
+          << "vertex format   " << (format == VertexFormat::Float ? "float" : format == VertexFormat::Unorm16 ? "unorm16" : "unorm8") << "\n"
+          << "frame ms avg    " << total / frames << "\n"
+          << "frame ms min    " << sorted.front() << "\n"
+          << "frame ms p50    " << sorted[frames / 2] << "\n"
+          << "frame ms p95    " << sorted[std::min(frames - 1, frames * 95 / 100)] << "\n"
+          << "frame ms max    " << sorted.back() << "\n"
+          << "submit ms avg   " << submitTotal / frames << "\n"
+          << "fps             " << 1000.0 * frames / total << "\n";
+    std::cout << stats.str();
+
+    std::ofstream statsFile(statsPath);
+    statsFile << stats.str();
+    if (!statsFile)
+        std::cout << "ERROR::HEADLESS:: Failed to write " << statsPath << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    if (!writeImage(imagePath, SCR_WIDTH, SCR_HEIGHT))
+        std::cout << "ERROR::HEADLESS:: Failed to write " << imagePath << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+#ifdef BSPLINE_PROFILE
+    if (Profiler::instance().writeChromeTrace("bspline_trace.json"))
+        std::cout << "profile written to bspline_trace.json" << std::endl;
+#endif
+
+#ifndef BSPLINE_HAS_EGL
+    glfwTerminate();
+#endif
+    return 0;
+}
+
+// construct curve
+// ---------------
+void createCurve()
+{
     vector<glm::vec3> controlPoints;
     controlPoints.push_back(glm::vec3(-0.6f, -0.7f, 0.0f));
     controlPoints.push_back(glm::vec3(-0.5f, -0.5f, 0.0f));
@@ -107,22 +343,22 @@ int main()
     //basisCurve = new BsplineCurve(controlPoints, knots);
     basisCurve = new BsplineCurve(controlPoints, knots, weights);
 
+    basisCurve->SetVertexPrecision(vertexPrecision);
     basisCurve->init();
+}
 
-    glPointSize(10.0f);
-    float ans;
-    glGetFloatv(GL_POINT_SIZE, &ans);
-    std::cout << ans << std::endl;
-
-    // framebuffer configuration
-    // -------------------------
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+// framebuffer configuration
+// -------------------------
+unsigned int createFramebuffer(const unsigned int width, const unsigned int height)
+{
+    unsigned int fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     // create a color attachment texture
     unsigned int textureColorbuffer;
     glGenTextures(1, &textureColorbuffer);
     glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
@@ -132,24 +368,24 @@ int main()
     glBindRenderbuffer(GL_RENDERBUFFER, rbo);
     glRenderbufferStorage(GL_RENDERBUFFER,
                           GL_DEPTH24_STENCIL8,
-                          SCR_WIDTH,
-                          SCR_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
+                          width,
+                          height); // use a single renderbuffer object for both a depth AND stencil buffer.
     glFramebufferRenderbuffer(
         GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
     // now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return fbo;
+}
 
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
+// picking pass into the id framebuffer, then the visible scene into sceneFramebuffer (0 for the window)
+// -----------------------------------------------------------------------------------------------------
+void renderScene(Shader& colorShader, Shader& colorIdShader, const unsigned int sceneFramebuffer)
+{
+    // 1. bind to framebuffer and render sphere to set sphere id
     {
-        // input
-        // -----
-        processInput(window);
-
-        // 1. bind to framebuffer and render sphere to set sphere id
+        PROFILE_GPU_SCOPE("Picking");
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
         // make sure we clear the framebuffer's content
@@ -161,9 +397,12 @@ int main()
 
         // render control points
         basisCurve->DrawControlPoints(colorIdShader);
+    }
 
-        // 2. Bind back to default framebuffer and draw scene
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // 2. Bind back to default framebuffer and draw scene
+    {
+        PROFILE_GPU_SCOPE("Draw");
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 
         // render
         // ------
@@ -177,19 +416,26 @@ int main()
         // draw curve
         basisCurve->Draw(colorShader);
         //basisCurve->DrawControlPoints(colorIdShader);
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
     }
+}
 
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
-    return 0;
+// save the bound read framebuffer as binary PPM
+// ---------------------------------------------
+bool writeImage(const std::string& path, const unsigned int width, const unsigned int height)
+{
+    std::vector<unsigned char> pixels(width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    // OpenGL rows start at the bottom
+    for (int row = (int)height - 1; row >= 0; row--)
+        file.write((const char*)&pixels[row * width * 3], width * 3);
+    return (bool)file;
 }
 
+#ifdef BSPLINE_HAS_GLFW
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
@@ -228,6 +474,13 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
+// F1 toggles the profiler stats overlay
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+        showStats = !showStats;
+}
+
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
     if (button == GLFW_MOUSE_BUTTON_LEFT)
@@ -255,4 +508,5 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
             draggingId = 255;
         }
     }
-}
\ No newline at end of file
+}
+#endif
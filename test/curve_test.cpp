@@ -0,0 +1,1173 @@
+// Headless behaviour tests for the curves and their helpers.
+// Built with BSPLINE_NO_GL like the performance tests, one CTest entry per test.
+//
+// usage: curve_test <test>
+
+#include "batch.h"
+#include "bezier.h"
+#include "bspline.h"
+#include "channels.h"
+#include "fitting.h"
+#include "interpolator.h"
+#include "smoothing.h"
+#include "store.h"
+#include "streaming.h"
+#include "view.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+static int g_failures = 0;
+
+#define CHECK(condition)                                                                         \
+    do                                                                                           \
+    {                                                                                            \
+        if (!(condition))                                                                        \
+        {                                                                                        \
+            cout << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << endl;       \
+            g_failures++;                                                                        \
+        }                                                                                        \
+    } while (0)
+
+static bool near(const glm::vec3& a, const glm::vec3& b, const float tolerance)
+{
+    return glm::length(a - b) <= tolerance;
+}
+
+static vector<glm::vec3> makeControlPoints(const int n)
+{
+    vector<glm::vec3> points(n);
+    for (int i = 0; i < n; i++)
+    {
+        float t = (float)i / (float)(n - 1);
+        points[i] = glm::vec3(2.0f * t - 1.0f, 0.5f * sin(6.0f * t), 0.25f * cos(5.0f * t));
+    }
+    return points;
+}
+
+// clamped knot vector with uniform interior knots on [0, 1]
+static vector<float> makeClampedKnots(const int n, const int p)
+{
+    vector<float> knots(n + p + 1);
+    const int spans = n - p;
+    for (int i = 0; i < (int)knots.size(); i++)
+    {
+        int k = min(max(i - p, 0), spans);
+        knots[i] = (float)k / (float)spans;
+    }
+    return knots;
+}
+
+static vector<float> makeWeights(const int n)
+{
+    vector<float> weights(n);
+    for (int i = 0; i < n; i++)
+        weights[i] = 1.0f + 0.5f * (i % 3);
+    return weights;
+}
+
+static glm::vec3 pointAt(const BsplineCurve& curve, const float u)
+{
+    BsplineCurve::DerivativeWorkspace workspace;
+    glm::vec3 point;
+    curve.EvaluateDerivatives(u, 0, &point, workspace);
+    return point;
+}
+
+// the curves describe the same shape over [0, 1]
+static bool sameShape(const BsplineCurve& a, const BsplineCurve& b, const float tolerance)
+{
+    for (int i = 0; i <= 200; i++)
+    {
+        const float u = (float)i / 200.0f;
+        if (!near(pointAt(a, u), pointAt(b, u), tolerance))
+            return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// knot insertion, refinement and removal
+
+static void testKnotInsertRemove()
+{
+    const int n = 8;
+    for (int rational = 0; rational < 2; rational++)
+    {
+        const BsplineCurve original = rational ? BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n))
+                                               : BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3));
+        BsplineCurve curve = original;
+        CHECK(curve.InsertKnot(0.3f, 2) == 2);
+        CHECK((int)curve.GetControlPoints().size() == n + 2);
+        CHECK(sameShape(curve, original, 1e-5f));
+
+        // the two copies of 0.3 come out again and give back the original control points
+        CHECK(curve.RemoveKnot(0.3f, 3, 1e-3f) == 2);
+        CHECK(curve.GetKnots() == original.GetKnots());
+        CHECK((int)curve.GetControlPoints().size() == n);
+        for (int i = 0; i < n && i < (int)curve.GetControlPoints().size(); i++)
+            CHECK(near(curve.GetControlPoints()[i], original.GetControlPoints()[i], 1e-4f));
+    }
+}
+
+static void testKnotRemoveMultiplicity()
+{
+    const int n = 8;
+    BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3));
+    CHECK(curve.InsertKnot(0.3f) == 1);
+
+    // more removals than copies of u, with a tolerance that accepts anything
+    CHECK(curve.RemoveKnot(0.3f, 3, 10.0f) == 1);
+    CHECK((int)curve.GetControlPoints().size() == n);
+}
+
+static void testKnotRefine()
+{
+    const int n = 8;
+    const BsplineCurve original(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+    BsplineCurve curve = original;
+    const vector<float> X = { 0.1f, 0.3f, 0.3f, 0.45f, 0.8f };
+    CHECK(curve.RefineKnots(X));
+    CHECK(curve.GetKnots().size() == original.GetKnots().size() + X.size());
+    CHECK((int)curve.GetControlPoints().size() == n + (int)X.size());
+    CHECK(sameShape(curve, original, 1e-5f));
+}
+
+static void testKnotOutsideDomain()
+{
+    const int n = 8;
+    BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3));
+    const vector<glm::vec3> controlPoints = curve.GetControlPoints();
+    CHECK(curve.InsertKnot(-0.5f) == 0);
+    CHECK(curve.InsertKnot(1.5f) == 0);
+    CHECK(!curve.RefineKnots({ 0.2f, 1.5f }));
+    CHECK(!curve.RefineKnots({ 0.6f, 0.2f }));
+    CHECK(curve.GetControlPoints() == controlPoints);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// Bezier extraction
+
+static void testBezierSegments()
+{
+    const int n = 9;
+    for (int rational = 0; rational < 2; rational++)
+    {
+        BsplineCurve curve = rational ? BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n))
+                                      : BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3));
+        CHECK(curve.InsertKnot(0.5f) == 1); // a double knot in the middle, segments still one per span
+        const BezierSegments& segments = curve.GetBezierSegments();
+        CHECK(segments.size() == n - 3);
+        CHECK(segments.degree() == 3);
+        CHECK(segments.start(0) == 0.0f && segments.end(segments.size() - 1) == 1.0f);
+        for (int i = 0; i <= 300; i++)
+        {
+            const float u = (float)i / 300.0f;
+            CHECK(near(segments.evaluate(u), pointAt(curve, u), 1e-5f));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// batched derivatives
+
+static void testBatchDerivatives()
+{
+    const int n = 9, k = 2;
+    const float h = 1e-3f;
+    vector<float> us;
+    for (int i = 1; i < 100; i++)
+        us.push_back((float)i / 100.0f);
+
+    // batch equals single point, first derivative equals a central difference of the positions
+    const BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+    vector<glm::vec3> ders;
+    curve.EvaluateDerivatives(us, k, ders);
+    CHECK(ders.size() == us.size() * (k + 1));
+    BsplineCurve::DerivativeWorkspace workspace;
+    for (int s = 0; s < (int)us.size(); s++)
+    {
+        glm::vec3 single[k + 1];
+        curve.EvaluateDerivatives(us[s], k, single, workspace);
+        for (int j = 0; j <= k; j++)
+            CHECK(near(ders[s * (k + 1) + j], single[j], 1e-5f * (1.0f + glm::length(single[j]))));
+        const glm::vec3 difference = (pointAt(curve, us[s] + h) - pointAt(curve, us[s] - h)) / (2.0f * h);
+        CHECK(near(ders[s * (k + 1) + 1], difference, 2e-2f * (1.0f + glm::length(difference))));
+    }
+
+    BezierCurve bezier(makeControlPoints(6), makeWeights(6));
+    vector<float> shifted(us.size() * 2);
+    for (int s = 0; s < (int)us.size(); s++)
+    {
+        shifted[2 * s] = us[s] - h;
+        shifted[2 * s + 1] = us[s] + h;
+    }
+    vector<glm::vec3> positions;
+    bezier.EvaluateDerivatives(shifted, 0, positions);
+    bezier.EvaluateDerivatives(us, 1, ders);
+    for (int s = 0; s < (int)us.size(); s++)
+    {
+        const glm::vec3 difference = (positions[2 * s + 1] - positions[2 * s]) / (2.0f * h);
+        CHECK(near(ders[s * 2 + 1], difference, 2e-2f * (1.0f + glm::length(difference))));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// arc length
+
+// length of a fine polyline through the curve from 0 to u
+static double polylineLength(const BsplineCurve& curve, const float u, const int samples = 20000)
+{
+    double length = 0.0;
+    glm::vec3 previous = pointAt(curve, 0.0f);
+    for (int i = 1; i <= samples; i++)
+    {
+        const glm::vec3 point = pointAt(curve, u * (float)i / (float)samples);
+        length += glm::length(point - previous);
+        previous = point;
+    }
+    return length;
+}
+
+static void testArcLength()
+{
+    const int n = 9;
+    BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+    const double length = polylineLength(curve, 1.0f);
+    CHECK(fabs(curve.GetArcLength().length() - length) <= 1e-4 * length);
+
+    // inverse lookup: the polyline up to the parameter of s is s long
+    const float s = 0.37f * (float)length;
+    const float u = curve.GetArcLength().parameter(curve, s);
+    CHECK(fabs(polylineLength(curve, u) - s) <= 1e-4 * length);
+
+    // moving a control point re-integrates the affected spans only, the total still has to follow
+    curve.MoveControlPoint(4, glm::vec3(0.0f, 0.3f, 0.0f));
+    const double moved = polylineLength(curve, 1.0f);
+    CHECK(fabs(moved - length) > 1e-3 * length);
+    CHECK(fabs(curve.GetArcLength().length() - moved) <= 1e-4 * moved);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// feed-rate interpolator
+
+static void testInterpolatorLimits()
+{
+    const int n = 9;
+    const BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+    const float period = 1e-3f, feed = 0.5f, maxAcceleration = 2.0f, maxJerk = 40.0f;
+    FeedRateInterpolator interpolator(curve, period, feed, maxAcceleration, maxJerk);
+
+    glm::vec3 position = pointAt(curve, 0.0f);
+    float acceleration = 0.0f, worstFeed = 0.0f, worstAcceleration = 0.0f, worstJerk = 0.0f, worstStep = 0.0f;
+    int ticks = 0;
+    FeedRateInterpolator::Setpoint setpoint;
+    do
+    {
+        setpoint = interpolator.tick();
+        worstFeed = max(worstFeed, setpoint.feed);
+        worstAcceleration = max(worstAcceleration, fabs(setpoint.acceleration));
+        worstJerk = max(worstJerk, fabs(setpoint.acceleration - acceleration) / period);
+        // no jumps: every setpoint is at most one commanded step from the previous one
+        worstStep = max(worstStep, glm::length(setpoint.position - position) - setpoint.feed * period);
+        acceleration = setpoint.acceleration;
+        position = setpoint.position;
+    } while (!setpoint.done && ++ticks < 1000000);
+
+    // at rest after the end
+    const FeedRateInterpolator::Setpoint rest = interpolator.tick();
+    worstJerk = max(worstJerk, fabs(rest.acceleration - acceleration) / period);
+
+    CHECK(setpoint.done);
+    CHECK(near(setpoint.position, pointAt(curve, 1.0f), 1e-6f));
+    CHECK(worstFeed <= feed * 1.0001f);
+    CHECK(worstAcceleration <= maxAcceleration * 1.001f);
+    CHECK(worstJerk <= maxJerk * 1.001f);
+    CHECK(worstStep <= 1e-6f);
+    // no creeping: the whole move takes less than twice the time at full feed plus the ramps
+    CHECK(ticks * period < 2.0f * interpolator.length() / feed + 4.0f * feed / maxAcceleration);
+    cout << "ticks " << ticks << ", feed " << worstFeed << ", acceleration " << worstAcceleration << ", jerk " << worstJerk
+         << ", step " << worstStep << endl;
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// closest point projection
+
+static void testProjection()
+{
+    const int n = 9;
+    const BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+
+    // a point on the curve projects to its own parameter, at distance zero
+    vector<glm::vec3> points;
+    for (int i = 0; i <= 50; i++)
+    {
+        const float u = (float)i / 50.0f;
+        points.push_back(pointAt(curve, u));
+        const CurveProjector::Result result = curve.Project(points.back());
+        CHECK(fabs(result.u - u) <= 1e-4f);
+        CHECK(result.distance <= 1e-5f);
+        CHECK(near(result.point, points.back(), 1e-5f));
+    }
+
+    // the batch gives the same answers
+    vector<CurveProjector::Result> results;
+    curve.ProjectBatch(points, results, 2);
+    CHECK(results.size() == points.size());
+    for (size_t i = 0; i < points.size() && i < results.size(); i++)
+        CHECK(results[i].u == curve.Project(points[i]).u);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// intersection
+
+static void testIntersection()
+{
+    const int n = 9;
+    const BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n));
+
+    // a short straight segment across the curve at u = 0.3, crossing it at its own midpoint
+    const float u = 0.3f;
+    BsplineCurve::DerivativeWorkspace workspace;
+    glm::vec3 ders[2];
+    curve.EvaluateDerivatives(u, 1, ders, workspace);
+    const glm::vec3 across = 0.1f * glm::normalize(glm::cross(ders[1], glm::vec3(0.0f, 0.0f, 1.0f)));
+    const vector<glm::vec3> line = { ders[0] - across, ders[0], ders[0] + across };
+    const BsplineCurve crossing(line, makeClampedKnots(3, 2), 2);
+
+    vector<CurveIntersection> hits;
+    curve.Intersect(crossing, 1e-5f, hits);
+    CHECK(hits.size() == 1);
+    if (!hits.empty())
+    {
+        CHECK(fabs(hits[0].u0 - u) <= 1e-4f);
+        CHECK(fabs(hits[0].u1 - 0.5f) <= 1e-4f);
+        CHECK(near(hits[0].point, ders[0], 1e-4f));
+    }
+
+    // the same crossing as a ray from the start of the segment
+    vector<RayIntersection> rayHits;
+    curve.IntersectRay(line[0], across, 1e-5f, rayHits);
+    CHECK(rayHits.size() == 1);
+    if (!rayHits.empty())
+    {
+        CHECK(fabs(rayHits[0].u - u) <= 1e-4f);
+        CHECK(fabs(rayHits[0].t - 1.0f) <= 1e-3f);
+    }
+
+    // a curve coincides with itself over its whole domain, reported as one overlap from end to end
+    curve.Intersect(curve, 1e-5f, hits);
+    CHECK(hits.size() == 2);
+    if (hits.size() == 2)
+    {
+        CHECK(hits[0].overlap && hits[1].overlap);
+        CHECK(hits[0].u0 <= 1e-3f && hits[1].u0 >= 1.0f - 1e-3f);
+    }
+    curve.Intersect(crossing, 1e-5f, hits);
+    CHECK(hits.size() == 1 && !hits[0].overlap);
+
+    // a ray along a straight curve from before its start, reported as one overlap
+    const BsplineCurve straight({ glm::vec3(0.0f), glm::vec3(0.2f, 0.1f, 0.0f), glm::vec3(0.7f, 0.35f, 0.0f),
+                                  glm::vec3(1.0f, 0.5f, 0.0f) },
+                                makeClampedKnots(4, 3));
+    straight.IntersectRay(glm::vec3(-1.0f, -0.5f, 0.0f), glm::vec3(2.0f, 1.0f, 0.0f), 1e-5f, rayHits);
+    CHECK(rayHits.size() == 2);
+    if (rayHits.size() == 2)
+    {
+        CHECK(rayHits[0].overlap && rayHits[1].overlap);
+        CHECK(rayHits[0].u <= 1e-3f && rayHits[1].u >= 1.0f - 1e-3f);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// segments, projection and intersection of an unclamped curve
+
+static void testUnclampedSegments()
+{
+    const int n = 8, p = 3;
+    vector<float> knots;
+    for (int i = 0; i <= n + p; i++)
+        knots.push_back((float)i / (float)(n + p));
+    const float first = knots[p], last = knots[n];
+    const BsplineCurve curve(makeControlPoints(n), knots, p);
+
+    // one segment per domain span, the knots outside [first, last] do not start or end any
+    const BezierSegments& segments = curve.GetBezierSegments();
+    CHECK(segments.size() == n - p);
+    CHECK(segments.start(0) == first && segments.end(segments.size() - 1) == last);
+    for (int i = 0; i <= 300; i++)
+    {
+        const float u = first + (last - first) * (float)i / 300.0f;
+        CHECK(near(segments.evaluate(u), pointAt(curve, u), 1e-5f));
+    }
+
+    vector<glm::vec3> points;
+    for (int i = 0; i <= 20; i++)
+    {
+        const float u = first + (last - first) * (float)i / 20.0f;
+        points.push_back(pointAt(curve, u));
+        CHECK(fabs(curve.Project(points.back()).u - u) <= 1e-4f);
+    }
+    vector<CurveProjector::Result> results;
+    curve.ProjectBatch(points, results, 2);
+    CHECK(results.size() == points.size());
+
+    // a crossing segment and ray at the middle of the domain
+    const float u = 0.5f * (first + last);
+    BsplineCurve::DerivativeWorkspace workspace;
+    glm::vec3 ders[2];
+    curve.EvaluateDerivatives(u, 1, ders, workspace);
+    const glm::vec3 across = 0.1f * glm::normalize(glm::cross(ders[1], glm::vec3(0.0f, 0.0f, 1.0f)));
+    const vector<glm::vec3> line = { ders[0] - across, ders[0], ders[0] + across };
+    const BsplineCurve crossing(line, makeClampedKnots(3, 2), 2);
+    vector<CurveIntersection> hits;
+    curve.Intersect(crossing, 1e-5f, hits);
+    CHECK(hits.size() == 1);
+    if (!hits.empty())
+        CHECK(fabs(hits[0].u0 - u) <= 1e-4f);
+    vector<RayIntersection> rayHits;
+    curve.IntersectRay(line[0], across, 1e-5f, rayHits);
+    CHECK(rayHits.size() == 1);
+    if (!rayHits.empty())
+        CHECK(fabs(rayHits[0].u - u) <= 1e-4f);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// least squares fitting
+
+static void testFitting()
+{
+    const int n = 12;
+    const vector<glm::vec3> original = makeControlPoints(n);
+    const vector<float> knots = makeClampedKnots(n, 3);
+    const BsplineCurve curve(original, knots);
+
+    // points sampled on a known curve at known parameters give back its control points, also when the
+    // normal equations are accumulated over several threads
+    const int count = 40000;
+    vector<glm::vec3> points(count);
+    vector<float> params(count);
+    for (int i = 0; i < count; i++)
+    {
+        params[i] = (float)i / (float)(count - 1);
+        points[i] = pointAt(curve, params[i]);
+    }
+    for (int threads = 1; threads <= 2; threads++)
+    {
+        BsplineFitter fitter(knots);
+        vector<float> known = params;
+        CHECK(fitter.fit(points, known, 0, threads));
+        CHECK(fitter.controlPoints().size() == original.size());
+        for (size_t i = 0; i < original.size() && i < fitter.controlPoints().size(); i++)
+            CHECK(near(fitter.controlPoints()[i], original[i], 1e-4f));
+        CHECK(fitter.residual(points, known) <= 1e-5f);
+    }
+
+    // chord length parameters and parameter correction: the residual drops with every correction
+    BsplineFitter fitter(knots);
+    vector<float> chord;
+    CHECK(fitter.fit(points, chord));
+    const float initial = fitter.residual(points, chord);
+    vector<float> corrected;
+    CHECK(fitter.fit(points, corrected, 3));
+    CHECK(fitter.residual(points, corrected) < 0.5f * initial);
+
+    // a control point without data makes the fit fail instead of returning garbage
+    vector<glm::vec3> half(points.begin(), points.begin() + count / 4);
+    vector<float> halfParams(params.begin(), params.begin() + count / 4);
+    CHECK(!BsplineFitter(knots).fit(half, halfParams));
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// streaming fit
+
+// feed samples of the uniform cubic spline with the given control points, perSpan samples per span
+static void streamSpline(StreamingSplineFitter& fitter, const vector<glm::vec3>& controlPoints, const double spacing, const int perSpan)
+{
+    const int spans = (int)controlPoints.size() - 3;
+    for (int s = 0; s < spans; s++)
+    {
+        for (int k = 0; k < perSpan; k++)
+        {
+            const float u = (float)k / (float)perSpan;
+            float b[4];
+            StreamingSplineFitter::basis(u, b);
+            glm::vec3 x(0.0f);
+            for (int j = 0; j < 4; j++)
+                x += b[j] * controlPoints[s + j];
+            fitter.push(((double)s + (double)u) * spacing, x);
+        }
+    }
+}
+
+static void testStreaming()
+{
+    const int n = 60;
+    const double spacing = 0.1;
+    vector<glm::vec3> original(n);
+    for (int i = 0; i < n; i++)
+        original[i] = glm::vec3(sin(0.3f * i), cos(0.2f * i), 0.05f * i);
+
+    // batch: a window over the whole stream is a single least squares solve at flush()
+    StreamingSplineFitter batch(spacing, n, 1e-6f);
+    streamSpline(batch, original, spacing, 20);
+    CHECK(batch.first() == 0);
+    batch.flush();
+    vector<glm::vec3> whole;
+    batch.takeFinalized(whole);
+
+    // sliding window of 12 spans over the same samples
+    StreamingSplineFitter window(spacing, 12, 1e-6f);
+    streamSpline(window, original, spacing, 20);
+    CHECK(window.first() > 0);
+    vector<glm::vec3> windowed;
+    window.takeFinalized(windowed);
+    CHECK((int)windowed.size() == window.first());
+    window.flush();
+    window.takeFinalized(windowed);
+
+    // both recover the spline the samples come from and agree with each other
+    CHECK(whole.size() == original.size());
+    CHECK(windowed.size() == original.size());
+    for (size_t i = 0; i < original.size() && i < whole.size() && i < windowed.size(); i++)
+    {
+        CHECK(near(whole[i], original[i], 1e-4f));
+        CHECK(near(windowed[i], whole[i], 1e-4f));
+    }
+
+    // a gap of several windows finalises the skipped points in a few solves and keeps going
+    StreamingSplineFitter gap(spacing, 4, 1e-3f);
+    gap.push(0.0, glm::vec3(0.0f));
+    gap.push(0.05, glm::vec3(0.0f));
+    gap.push(30.0 * spacing, glm::vec3(1.0f));
+    CHECK(gap.first() > 20);
+    vector<glm::vec3> skipped;
+    gap.takeFinalized(skipped);
+    CHECK((int)skipped.size() == gap.first());
+    for (const glm::vec3& point : skipped)
+        CHECK(glm::all(glm::lessThan(glm::abs(point), glm::vec3(10.0f))));
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// smoothing spline
+
+static void testSmoothing()
+{
+    const vector<glm::vec3> points = makeControlPoints(12);
+
+    // smoothing 0 interpolates: the same knots values and vertices as SplineCurve
+    SmoothingSplineCurve smooth(points, 0.0f);
+    SplineCurve spline(points);
+    smooth.Tessellate();
+    spline.Tessellate();
+    CHECK(smooth.GetFittedPoints().size() == points.size());
+    for (size_t i = 0; i < points.size() && i < smooth.GetFittedPoints().size(); i++)
+        CHECK(near(smooth.GetFittedPoints()[i], points[i], 1e-5f));
+    CHECK(smooth.GetVertices().size() == spline.GetVertices().size());
+    for (size_t i = 0; i < smooth.GetVertices().size() && i < spline.GetVertices().size(); i++)
+        CHECK(near(smooth.GetVertices()[i], spline.GetVertices()[i], 1e-5f));
+
+    // a very large smoothing leaves the least squares line: no second differences
+    smooth.SetSmoothing(1e7f);
+    smooth.Tessellate();
+    const vector<glm::vec3>& fitted = smooth.GetFittedPoints();
+    for (size_t i = 1; i + 1 < fitted.size(); i++)
+        CHECK(near(fitted[i - 1] - 2.0f * fitted[i] + fitted[i + 1], glm::vec3(0.0f), 1e-4f));
+
+    // the O(n) trace behind the GCV score against the dense tr(I - S) of a small fit, the fitted values
+    // are S y so column j of S is the fit of the unit data e_j
+    const int n = 8;
+    const vector<glm::vec3> data = makeControlPoints(n);
+    for (const float smoothing : { 1e-2f, 1.0f, 100.0f })
+    {
+        double dense = n;
+        for (int j = 0; j < n; j++)
+        {
+            vector<glm::vec3> unit(n, glm::vec3(0.0f));
+            unit[j].x = 1.0f;
+            SmoothingSplineCurve column(unit, smoothing);
+            column.Tessellate();
+            dense -= column.GetFittedPoints()[j].x;
+        }
+
+        SmoothingSplineCurve curve(data, smoothing);
+        curve.Tessellate();
+        double rss = 0.0;
+        for (int j = 0; j < n; j++)
+        {
+            const glm::dvec3 r = glm::dvec3(data[j]) - glm::dvec3(curve.GetFittedPoints()[j]);
+            rss += glm::dot(r, r);
+        }
+        // GCV = (RSS / n) / (tr(I - S) / n)^2
+        const double fast = n * sqrt(rss / n / curve.GeneralizedCrossValidation(smoothing));
+        CHECK(fabs(fast - dense) <= 1e-3 * dense);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// homogeneous control points
+
+static void testRationalEdit()
+{
+    // moving a control point of a NURBS curve keeps its weight: the curve equals one built with the moved
+    // point and the same weights
+    const int n = 9;
+    vector<glm::vec3> points = makeControlPoints(n);
+    const vector<float> knots = makeClampedKnots(n, 3);
+    BsplineCurve curve(points, knots, makeWeights(n));
+    const glm::vec3 offset(0.1f, 0.4f, -0.2f);
+    curve.MoveControlPoint(5, offset);
+    points[5] += offset;
+    CHECK(sameShape(curve, BsplineCurve(points, knots, makeWeights(n)), 1e-6f));
+
+    // replacing all control points keeps the weights as well
+    points = makeControlPoints(n);
+    curve.SetControlPoints(points);
+    CHECK(sameShape(curve, BsplineCurve(points, knots, makeWeights(n)), 1e-6f));
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// tessellation
+
+static void testTessellationEnds()
+{
+    // the sample parameters are i * delta, not a running sum: whatever the count, the vertices start and end
+    // on the end control points (the curves are clamped) and there is one more vertex than segments
+    const int n = 9;
+    const vector<glm::vec3> points = makeControlPoints(n);
+    for (const int count : { 3, 49, 100, 997, 5000 })
+    {
+        BezierCurve bezier(points, makeWeights(n), count);
+        BsplineCurve bspline(points, makeClampedKnots(n, 3), makeWeights(n), 3, count);
+        bezier.Tessellate();
+        bspline.Tessellate();
+        for (const vector<glm::vec3>* vertices : { &bezier.GetVertices(), &bspline.GetVertices() })
+        {
+            CHECK(!vertices->empty());
+            if (vertices->empty())
+                continue;
+            CHECK(near(vertices->front(), points.front(), 1e-6f));
+            CHECK(near(vertices->back(), points.back(), 1e-6f));
+        }
+        CHECK((int)bezier.GetVertices().size() == count + 1);
+    }
+
+    // forward differencing over long runs of samples on uniform spans stays on the evaluated curve
+    const int size = 6, count = 100000;
+    for (int p = 1; p <= 3; p++)
+    {
+        vector<float> knots;
+        for (int i = 0; i <= size + p; i++)
+            knots.push_back((float)i / (float)(size + p));
+        for (int rational = 0; rational < 2; rational++)
+        {
+            BsplineCurve curve = rational ? BsplineCurve(makeControlPoints(size), knots, makeWeights(size), p, count)
+                                          : BsplineCurve(makeControlPoints(size), knots, p, count);
+            curve.Tessellate();
+            const vector<glm::vec3>& vertices = curve.GetVertices();
+            CHECK((int)vertices.size() == count + 1);
+            float worst = 0.0f;
+            for (int i = 0; i < (int)vertices.size(); i++)
+            {
+                const float u = (float)i / (float)count;
+                if (u >= knots[p] && u <= knots[size])
+                    worst = max(worst, glm::length(vertices[i] - pointAt(curve, u)));
+            }
+            CHECK(worst <= 1e-5f);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// subdivision tessellation
+
+static void testSubdivision()
+{
+    // level L puts the vertices on the curve at the knots refined L times, h / 2^L apart over the domain
+    const int size = 9;
+    for (int p = 1; p <= 5; p++)
+    {
+        vector<float> knots;
+        for (int i = 0; i <= size + p; i++)
+            knots.push_back((float)i / (float)(size + p));
+        const float h = knots[1] - knots[0];
+        for (int rational = 0; rational < 2; rational++)
+        {
+            BsplineCurve curve = rational ? BsplineCurve(makeControlPoints(size), knots, makeWeights(size), p)
+                                          : BsplineCurve(makeControlPoints(size), knots, p);
+            for (int level = 1; level <= 4; level++)
+            {
+                curve.SetSubdivisionLevel(level);
+                curve.Tessellate();
+                const vector<glm::vec3>& vertices = curve.GetVertices();
+                const int spans = (size - p) << level;
+                CHECK((int)vertices.size() == spans + 1);
+                for (int k = 0; k <= spans && k < (int)vertices.size(); k++)
+                    CHECK(near(vertices[k], pointAt(curve, knots[p] + h * (float)k / (float)(1 << level)), 1e-5f));
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// point evaluation with the reciprocal knot tables
+
+// rational point at u by Cox-de Boor with divisions (The NURBS Book A2.2) in double, u at the last knot
+// taken from the last nonempty span
+static glm::vec3 divisionPoint(const vector<glm::vec3>& points,
+                               const vector<float>& weights,
+                               const vector<float>& knots,
+                               const int p,
+                               const float u)
+{
+    const int n = points.size() - 1;
+    int span = p;
+    while (span < n && u >= knots[span + 1])
+        span++;
+    vector<double> N(p + 1), left(p + 1), right(p + 1);
+    N[0] = 1.0;
+    for (int j = 1; j <= p; j++)
+    {
+        left[j] = (double)u - knots[span + 1 - j];
+        right[j] = (double)knots[span + j] - u;
+        double saved = 0.0;
+        for (int r = 0; r < j; r++)
+        {
+            const double temp = N[r] / (right[r + 1] + left[j - r]);
+            N[r] = saved + right[r + 1] * temp;
+            saved = left[j - r] * temp;
+        }
+        N[j] = saved;
+    }
+    glm::dvec4 point(0.0);
+    for (int r = 0; r <= p; r++)
+    {
+        const double w = weights[span - p + r];
+        point += N[r] * glm::dvec4(w * glm::dvec3(points[span - p + r]), w);
+    }
+    return glm::vec3(glm::dvec3(point) / point.w);
+}
+
+static void testReciprocalBasis()
+{
+    // non-uniform knots so that every sample goes through the reciprocal tables, with an interior knot
+    // of multiplicity p hit by a sample and the last sample at the last knot
+    const int count = 400;
+    for (int p = 2; p <= 3; p++)
+    {
+        vector<float> knots(p + 1, 0.0f);
+        for (const float knot : { 0.15f, 0.31f })
+            knots.push_back(knot);
+        knots.insert(knots.end(), p, 0.5f);
+        for (const float knot : { 0.62f, 0.9f })
+            knots.push_back(knot);
+        knots.insert(knots.end(), p + 1, 1.0f);
+        const int n = knots.size() - p - 1;
+        const vector<glm::vec3> points = makeControlPoints(n);
+        const vector<float> weights = makeWeights(n);
+
+        BsplineCurve curve(points, knots, weights, p, count);
+        curve.Tessellate();
+        const vector<glm::vec3>& vertices = curve.GetVertices();
+        CHECK((int)vertices.size() == count + 1);
+        for (int i = 0; i <= count && i < (int)vertices.size(); i++)
+            CHECK(near(vertices[i], divisionPoint(points, weights, knots, p, (float)i / (float)count), 1e-5f));
+        if (!vertices.empty())
+            CHECK(near(vertices.back(), points.back(), 1e-6f));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// multi-channel curves
+
+static void testChannels()
+{
+    // channels 0..2 are the coordinates of a curve, channel 3 a second curve: every channel equals the
+    // derivatives of its own BsplineCurve
+    const int n = 9, k = 3, channels = 4;
+    const vector<glm::vec3> points = makeControlPoints(n);
+    vector<glm::vec3> other(n);
+    for (int i = 0; i < n; i++)
+        other[i] = glm::vec3(points[i].y * points[i].y, 0.0f, 0.0f);
+    const vector<float> knots = makeClampedKnots(n, 3);
+    const BsplineCurve curve(points, knots), otherCurve(other, knots);
+
+    BsplineChannels tracks(knots, 3, channels);
+    CHECK(tracks.size() == n);
+    CHECK(!tracks.setControlPoints(vector<float>(n * channels - 1, 1.0f)));
+    CHECK(tracks.controlPoint(0)[0] == 0.0f);
+    vector<float> values(n * channels);
+    for (int i = 0; i < n; i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+            values[i * channels + axis] = points[i][axis];
+        values[i * channels + 3] = other[i].x;
+    }
+    CHECK(tracks.setControlPoints(values));
+
+    vector<float> us, out;
+    for (int i = 0; i <= 100; i++)
+        us.push_back((float)i / 100.0f);
+    tracks.evaluate(us, k, out);
+    CHECK(out.size() == us.size() * (k + 1) * channels);
+    vector<glm::vec3> ders, otherDers;
+    curve.EvaluateDerivatives(us, k, ders);
+    otherCurve.EvaluateDerivatives(us, k, otherDers);
+    for (int s = 0; s < (int)us.size(); s++)
+    {
+        for (int j = 0; j <= k; j++)
+        {
+            const float* row = &out[(s * (k + 1) + j) * channels];
+            const glm::vec3& expected = ders[s * (k + 1) + j];
+            CHECK(near(glm::vec3(row[0], row[1], row[2]), expected, 1e-5f * (1.0f + glm::length(expected))));
+            CHECK(fabs(row[3] - otherDers[s * (k + 1) + j].x) <= 1e-5f * (1.0f + fabs(row[3])));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// curve batches
+
+static void testBatch()
+{
+    // more curves than one block, each one's vertices equal its own BsplineCurve on the grid
+    const int n = 9, curves = BsplineBatch::width + 3;
+    const vector<float> knots = makeClampedKnots(n, 3);
+    BsplineBatch batch(knots, 3);
+    CHECK(batch.add(makeControlPoints(n + 1)) == -1);
+    CHECK(batch.size() == 0);
+    vector<vector<glm::vec3>> points(curves);
+    for (int c = 0; c < curves; c++)
+    {
+        points[c] = makeControlPoints(n);
+        for (glm::vec3& point : points[c])
+            point = point * (1.0f + 0.1f * c) + glm::vec3(0.0f, 0.05f * c, 0.0f);
+        CHECK(batch.add(points[c]) == c);
+    }
+
+    const int count = 64;
+    batch.setUniformParameters(count);
+    CHECK(batch.samples() == count + 1);
+    vector<float> vertices;
+    batch.evaluate(vertices);
+    vector<float> us(count + 1);
+    for (int i = 0; i <= count; i++)
+        us[i] = i == count ? 1.0f : (float)i / (float)count;
+    vector<glm::vec3> own, ders;
+    for (int c = 0; c < curves; c++)
+    {
+        batch.curveVertices(vertices, c, own);
+        BsplineCurve(points[c], knots).EvaluateDerivatives(us, 0, ders);
+        CHECK(own.size() == ders.size());
+        for (size_t s = 0; s < own.size() && s < ders.size(); s++)
+            CHECK(near(own[s], ders[s], 1e-5f));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// shared knot tables
+
+static void testKnotSharing()
+{
+    const int n = 9;
+    const size_t before = KnotTables::internedCount();
+    vector<float> knots = makeClampedKnots(n, 3);
+    knots[5] = 0.31f; // distinct from the knots of the other tests
+    {
+        BsplineCurve a(makeControlPoints(n), knots);
+        CHECK(KnotTables::internedCount() == before + 1);
+
+        // equal knots share one instance, copies too
+        BsplineCurve b(makeControlPoints(n), knots, makeWeights(n));
+        const BsplineCurve c = a;
+        CHECK(KnotTables::internedCount() == before + 1);
+        CHECK(a.GetKnots().data() == b.GetKnots().data());
+        CHECK(a.GetKnots().data() == c.GetKnots().data());
+
+        // a knot insertion moves one curve to new tables, the others keep theirs
+        CHECK(b.InsertKnot(0.6f) == 1);
+        CHECK(KnotTables::internedCount() == before + 2);
+        CHECK(a.GetKnots().data() == c.GetKnots().data());
+        CHECK(a.GetKnots().size() + 1 == b.GetKnots().size());
+    }
+    // freed with the last curve
+    CHECK(KnotTables::internedCount() == before);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// non-owning views
+
+static void testView()
+{
+    const int n = 9, k = 2;
+    const vector<glm::vec3> points = makeControlPoints(n);
+    const vector<float> knots = makeClampedKnots(n, 3);
+    const vector<float> weights = makeWeights(n);
+    vector<float> us;
+    for (int i = 0; i <= 200; i++)
+        us.push_back((float)i / 200.0f);
+
+    for (int rational = 0; rational < 2; rational++)
+    {
+        // a view over the same arrays evaluates like the owning curve
+        const BsplineCurve curve = rational ? BsplineCurve(points, knots, weights) : BsplineCurve(points, knots);
+        const BsplineView view(points.data(), n, knots.data(), 3, rational ? weights.data() : nullptr);
+        CHECK(view.GetSize() == n && view.GetDegree() == 3);
+        vector<glm::vec3> owned, viewed;
+        curve.EvaluateDerivatives(us, k, owned);
+        view.EvaluateDerivatives(us, k, viewed);
+        CHECK(owned.size() == viewed.size());
+        for (size_t i = 0; i < owned.size() && i < viewed.size(); i++)
+            CHECK(near(owned[i], viewed[i], 1e-6f * (1.0f + glm::length(owned[i]))));
+
+        // and the helpers that only evaluate work on it: the same arc length index
+        vector<float> breaks;
+        for (int i = 3; i <= n; i++)
+            if (breaks.empty() || knots[i] > breaks.back())
+                breaks.push_back(knots[i]);
+        ArcLengthTable table;
+        table.build(view, breaks, 4);
+        CHECK(fabs(table.length() - curve.GetArcLength().length()) <= 1e-6f * table.length());
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// curve stores
+
+static void testCurveStore()
+{
+    const int n = 9;
+    vector<float> knots = makeClampedKnots(n, 3);
+    knots[6] = 0.52f; // tables of their own, to see the destructors run
+    const size_t tables = KnotTables::internedCount();
+
+    CurveStore<BsplineCurve> store(4);
+    vector<BsplineCurve*> curves;
+    for (int i = 0; i < 6; i++)
+        curves.push_back(store.create(makeControlPoints(n), knots));
+    CHECK(store.size() == 6);
+    CHECK(KnotTables::internedCount() == tables + 1);
+
+    // destroyed slots are handed out again, the most recent first, before any new slot
+    store.destroy(curves[2]);
+    store.destroy(curves[4]);
+    CHECK(store.size() == 4);
+    CHECK(store.create(makeControlPoints(n), knots) == curves[4]);
+    CHECK(store.create(makeControlPoints(n), knots) == curves[2]);
+    BsplineCurve* next = store.create(makeControlPoints(n), knots);
+    CHECK(next != curves[2] && next != curves[4]);
+    int alive = 0;
+    store.forEach([&](BsplineCurve&) { alive++; });
+    CHECK(alive == 7 && store.size() == 7);
+
+    // clear() runs the destructors and keeps the blocks: the next curve goes to the first slot
+    store.clear();
+    CHECK(store.size() == 0);
+    CHECK(KnotTables::internedCount() == tables);
+    CHECK(store.create(makeControlPoints(n), knots) == curves[0]);
+}
+
+static void testViewStore()
+{
+    const int n = 9;
+    const vector<float> knots = makeClampedKnots(n, 3);
+    BsplineViewStore store(4096);
+    const BsplineView* a = store.create(makeControlPoints(n), knots, 3);
+    const BsplineView* b = store.create(makeControlPoints(n), knots, 3, makeWeights(n));
+    CHECK(store.size() == 2);
+    CHECK(a->GetKnots() == b->GetKnots()); // consecutive equal knots are stored once
+
+    // the views evaluate like the curves they were copied from
+    const BsplineCurve plain(makeControlPoints(n), knots), rational(makeControlPoints(n), knots, makeWeights(n));
+    BsplineCurve::DerivativeWorkspace workspace;
+    for (int i = 0; i <= 20; i++)
+    {
+        const float u = (float)i / 20.0f;
+        glm::vec3 point;
+        a->EvaluateDerivatives(u, 0, &point, workspace);
+        CHECK(near(point, pointAt(plain, u), 1e-6f));
+        store[1].EvaluateDerivatives(u, 0, &point, workspace);
+        CHECK(near(point, pointAt(rational, u), 1e-6f));
+    }
+
+    // clear() keeps the arena blocks for the next scene
+    const size_t capacity = store.arena().capacity();
+    store.clear();
+    CHECK(store.size() == 0);
+    store.create(makeControlPoints(n), knots, 3);
+    CHECK(store.arena().capacity() == capacity);
+
+    // alignments beyond what the heap guarantees for the blocks, also at the start of a new block
+    struct alignas(64) Wide
+    {
+        float values[3];
+    };
+    Arena arena(256);
+    for (int i = 0; i < 20; i++)
+    {
+        arena.allocate<char>(1 + i % 7);
+        const Wide* wide = arena.allocate<Wide>(1 + i % 3);
+        CHECK(reinterpret_cast<uintptr_t>(wide) % alignof(Wide) == 0);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// vertex residency
+
+static void testVertexResidency()
+{
+    const int n = 9;
+    for (const VertexResidency residency : { VertexResidency::Keep, VertexResidency::Discard, VertexResidency::Compressed })
+    {
+        BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n), 3, 1000);
+        curve.SetVertexResidency(residency);
+        curve.Tessellate();
+        const vector<glm::vec3> original = curve.GetVertices();
+        const int count = curve.GetVertexCount();
+
+        curve.ReleaseVertices();
+        CHECK(curve.GetVertices().empty() == (residency != VertexResidency::Keep));
+        CHECK(curve.GetVertexCount() == count);
+
+        // exact when kept or regenerated, within half a quantization step (plus the float rounding of
+        // coordinates around 1) when compressed
+        glm::vec3 lo = original[0], hi = original[0];
+        for (const glm::vec3& v : original)
+        {
+            lo = glm::min(lo, v);
+            hi = glm::max(hi, v);
+        }
+        const float tolerance = residency == VertexResidency::Compressed ? PackedVertices::error(hi - lo) + 4.0f * FLT_EPSILON : 0.0f;
+        const vector<glm::vec3> restored = curve.RestoreVertices();
+        CHECK(restored.size() == original.size());
+        for (size_t i = 0; i < restored.size() && i < original.size(); i++)
+            CHECK(glm::all(glm::lessThanEqual(glm::abs(restored[i] - original[i]), glm::vec3(tolerance))));
+
+        // an edit tessellates again: the next round trip brings back the new vertices, not the old ones
+        curve.MoveControlPoint(4, glm::vec3(0.0f, 0.5f, 0.0f));
+        const vector<glm::vec3> edited = curve.GetVertices();
+        curve.ReleaseVertices();
+        const vector<glm::vec3>& again = curve.RestoreVertices();
+        CHECK(again.size() == edited.size());
+        if (!again.empty() && !edited.empty())
+            CHECK(near(again[again.size() / 2], edited[edited.size() / 2], 1e-3f));
+        CHECK(!near(edited[edited.size() / 2], original[original.size() / 2], 1e-2f));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// quantized vertices
+
+// unpack(pack(vertices)) within the quantization error of the bounding box, per coordinate
+template <typename T>
+static void checkPackedRoundTrip(const vector<glm::vec3>& vertices)
+{
+    PackedVerticesT<T> packed;
+    packed.pack(vertices);
+    vector<glm::vec3> unpacked;
+    packed.unpack(unpacked);
+    CHECK(unpacked.size() == vertices.size());
+    const float tolerance = PackedVerticesT<T>::error(packed.extent()) + 4.0f * FLT_EPSILON;
+    for (size_t i = 0; i < unpacked.size() && i < vertices.size(); i++)
+        CHECK(glm::all(glm::lessThanEqual(glm::abs(unpacked[i] - vertices[i]), glm::vec3(tolerance))));
+}
+
+static void testPackedVertices()
+{
+    const int n = 9;
+    BsplineCurve curve(makeControlPoints(n), makeClampedKnots(n, 3), makeWeights(n), 3, 1000);
+    curve.Tessellate();
+    checkPackedRoundTrip<uint8_t>(curve.GetVertices());
+    checkPackedRoundTrip<uint16_t>(curve.GetVertices());
+
+    // a flat axis has scale 0 and comes back exactly
+    vector<glm::vec3> flat;
+    for (int i = 0; i <= 100; i++)
+        flat.push_back(glm::vec3(0.01f * i, 0.5f * sin(0.1f * i), 0.3f));
+    checkPackedRoundTrip<uint8_t>(flat);
+    checkPackedRoundTrip<uint16_t>(flat);
+    PackedVertices packed;
+    packed.pack(flat);
+    CHECK(packed.scale.z == 0.0f);
+    vector<glm::vec3> unpacked;
+    packed.unpack(unpacked);
+    for (const glm::vec3& v : unpacked)
+        CHECK(v.z == 0.3f);
+
+    // the format follows the precision budget: floats by default, the smallest one within the budget
+    glm::vec3 lo = curve.GetVertices()[0], hi = lo;
+    for (const glm::vec3& v : curve.GetVertices())
+    {
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+    }
+    const float error8 = PackedVerticesT<uint8_t>::error(hi - lo), error16 = PackedVertices::error(hi - lo);
+    CHECK(curve.SelectVertexFormat() == VertexFormat::Float);
+    curve.SetVertexPrecision(error8);
+    CHECK(curve.SelectVertexFormat() == VertexFormat::Unorm8);
+    curve.SetVertexPrecision(0.5f * error8);
+    CHECK(curve.SelectVertexFormat() == VertexFormat::Unorm16);
+    curve.SetVertexPrecision(0.5f * error16);
+    CHECK(curve.SelectVertexFormat() == VertexFormat::Float);
+    curve.SetVertexPrecision(0.0f);
+    CHECK(curve.SelectVertexFormat() == VertexFormat::Float);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+
+struct Test
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Test tests[] = {
+    { "knot_insert_remove", testKnotInsertRemove },
+    { "knot_remove_multiplicity", testKnotRemoveMultiplicity },
+    { "knot_refine", testKnotRefine },
+    { "knot_outside_domain", testKnotOutsideDomain },
+    { "bezier_segments", testBezierSegments },
+    { "batch_derivatives", testBatchDerivatives },
+    { "arc_length", testArcLength },
+    { "interpolator_limits", testInterpolatorLimits },
+    { "projection", testProjection },
+    { "intersection", testIntersection },
+    { "unclamped_segments", testUnclampedSegments },
+    { "fitting", testFitting },
+    { "streaming", testStreaming },
+    { "smoothing", testSmoothing },
+    { "rational_edit", testRationalEdit },
+    { "tessellation_ends", testTessellationEnds },
+    { "subdivision", testSubdivision },
+    { "reciprocal_basis", testReciprocalBasis },
+    { "channels", testChannels },
+    { "batch", testBatch },
+    { "knot_sharing", testKnotSharing },
+    { "view", testView },
+    { "curve_store", testCurveStore },
+    { "view_store", testViewStore },
+    { "vertex_residency", testVertexResidency },
+    { "packed_vertices", testPackedVertices },
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        cout << "usage: curve_test <test>" << endl;
+        return 2;
+    }
+    for (const Test& test : tests)
+    {
+        if (strcmp(argv[1], test.name) != 0)
+            continue;
+        test.run();
+        cout << test.name << ": " << (g_failures ? "FAIL" : "ok") << endl;
+        return g_failures ? 1 : 0;
+    }
+    cout << "unknown test " << argv[1] << endl;
+    return 2;
+}
@@ -0,0 +1,275 @@
+// Headless performance regression test for the curve evaluation kernels.
+// Built with BSPLINE_NO_GL, so it needs neither a window nor an OpenGL context.
+//
+// usage: perf_test <kernel> <baseline file>
+
+#include "bezier.h"
+#include "bspline.h"
+#include "spline.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+// count heap allocations so that per-sample allocations show up as failures; every form of operator new
+// and delete is replaced so that all allocations are counted and every free matches its allocator
+static std::atomic<long long> g_allocations(0);
+
+static void* countedAlloc(size_t size, size_t alignment)
+{
+    g_allocations++;
+    size = size ? size : 1;
+    void* ptr = alignment <= alignof(std::max_align_t) ? malloc(size) : aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+static void countedFree(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void* operator new(size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new[](size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return countedAlloc(size, 0);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return countedAlloc(size, 0);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    countedFree(ptr);
+}
+
+struct Baseline
+{
+    double samplesPerSecond = 0.0;
+    double tolerance = 0.0;
+};
+
+static bool readBaseline(const string& path, const string& kernel, Baseline& baseline)
+{
+    ifstream file(path);
+    string line;
+    while (getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        istringstream stream(line);
+        string name;
+        stream >> name >> baseline.samplesPerSecond >> baseline.tolerance;
+        if (name == kernel)
+            return true;
+    }
+    return false;
+}
+
+static vector<glm::vec3> makeControlPoints(const int n)
+{
+    vector<glm::vec3> points(n);
+    for (int i = 0; i < n; i++)
+    {
+        float t = (float)i / (float)(n - 1);
+        points[i] = glm::vec3(2.0f * t - 1.0f, 0.5f * sin(12.0f * t), 0.25f * cos(7.0f * t));
+    }
+    return points;
+}
+
+// clamped knot vector with uniform interior knots on [0, 1]
+static vector<float> makeClampedKnots(const int n, const int p)
+{
+    vector<float> knots(n + p + 1);
+    const int spans = n - p;
+    for (int i = 0; i < (int)knots.size(); i++)
+    {
+        int k = min(max(i - p, 0), spans);
+        knots[i] = (float)k / (float)spans;
+    }
+    return knots;
+}
+
+static BasisCurve* makeCurve(const string& kernel)
+{
+    if (kernel == "bspline_cubic")
+    {
+        const int n = 64;
+        return new BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3), 3, 200000);
+    }
+    if (kernel == "nurbs_cubic")
+    {
+        const int n = 64;
+        vector<float> weights(n);
+        for (int i = 0; i < n; i++)
+            weights[i] = 1.0f + 0.5f * (i % 3);
+        return new BsplineCurve(makeControlPoints(n), makeClampedKnots(n, 3), weights, 3, 200000);
+    }
+    if (kernel == "bezier_deg20")
+    {
+        return new BezierCurve(makeControlPoints(21), 20000);
+    }
+    if (kernel == "spline_solve_1e5")
+    {
+        const int n = 100000;
+        return new SplineCurve(makeControlPoints(n), n - 1);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cout << "usage: perf_test <kernel> <baseline file>" << endl;
+        return 2;
+    }
+    const string kernel = argv[1];
+
+    Baseline baseline;
+    if (!readBaseline(argv[2], kernel, baseline))
+    {
+        cout << "no baseline for kernel " << kernel << " in " << argv[2] << endl;
+        return 2;
+    }
+
+    BasisCurve* curve = makeCurve(kernel);
+    if (!curve)
+    {
+        cout << "unknown kernel " << kernel << endl;
+        return 2;
+    }
+
+    // warm up: sizes the scratch and vertex buffers
+    curve->Tessellate();
+
+    const double minDuration = 0.3; // seconds
+    double best = 1e30;
+    double elapsed = 0.0;
+    long long samples = 0;
+    long long allocations = 0;
+    int runs = 0;
+    while (elapsed < minDuration || runs < 3)
+    {
+        long long before = g_allocations;
+        auto start = chrono::steady_clock::now();
+        curve->Tessellate();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        allocations += g_allocations - before;
+
+        best = min(best, seconds);
+        elapsed += seconds;
+        samples += curve->GetVertices().size();
+        runs++;
+    }
+
+    const double throughput = curve->GetVertices().size() / best;
+    const double threshold = baseline.samplesPerSecond * (1.0 - baseline.tolerance);
+    const double allocationsPerSample = (double)allocations / (double)samples;
+    cout << kernel << ": " << throughput << " samples/s (baseline " << baseline.samplesPerSecond << ", threshold "
+         << threshold << "), " << allocationsPerSample << " allocations/sample over " << runs << " runs" << endl;
+
+    bool passed = true;
+    if (throughput < threshold)
+    {
+        cout << "FAIL: throughput below threshold" << endl;
+        passed = false;
+    }
+    if (allocations != 0)
+    {
+        cout << "FAIL: tessellation allocates on the heap" << endl;
+        passed = false;
+    }
+    if (throughput > 2.0 * baseline.samplesPerSecond)
+        cout << "note: throughput is more than twice the baseline, consider raising it" << endl;
+
+    delete curve;
+    return passed ? 0 : 1;
+}